@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct actor_message_tag;
+    struct actor_run_tag;
+
+    class actor;
+    class actor_system;
+
+    // Message owned by the caller. While it waits in a mailbox it is linked
+    // through mailbox_next, once drained through the list hook.
+    class actor_message : public list_element<actor_message_tag>
+    {
+    private:
+        friend class actor;
+        friend class actor_system;
+        actor_message *mailbox_next = nullptr;
+    public:
+        actor_message() = default;
+        actor_message(actor_message const&) = delete;
+        actor_message& operator=(actor_message const&) = delete;
+        virtual ~actor_message() = default;
+    };
+
+    // Actors process their messages one at a time, on whatever worker picked
+    // them up. receive() gets a message that is already out of the mailbox,
+    // so it may send the same message on; it must not throw.
+    class actor : public list_element<actor_run_tag>
+    {
+    private:
+        friend class actor_system;
+        actor_system &sys;
+        // senders push here without locks, newest first
+        std::atomic<actor_message*> mailbox{nullptr};
+        std::atomic<bool> scheduled{false};
+        // drained messages in arrival order, touched by the running worker only
+        list<actor_message, actor_message_tag> inbox;
+    public:
+        explicit actor(actor_system &s) noexcept
+            : sys(s)
+        {}
+        actor(actor const&) = delete;
+        actor& operator=(actor const&) = delete;
+        virtual ~actor() = default;
+
+        virtual void receive(actor_message &m) = 0;
+
+        actor_system &system() const noexcept
+        {
+            return sys;
+        }
+    };
+
+    // Runs actors on a pool of threads. A send is a lock-free push onto the
+    // mailbox; the first send to an idle actor also puts it on the run queue.
+    // A turn detaches the whole mailbox with one exchange, appends it to the
+    // actor's inbox and delivers up to quantum messages, then the actor goes
+    // to the back of the run queue if anything is left. Actors and messages
+    // must stay alive until wait_idle() has returned.
+    class actor_system
+    {
+    private:
+        std::size_t quantum;
+        std::mutex m;
+        std::condition_variable work_cv;
+        std::condition_variable idle_cv;
+        list<actor, actor_run_tag> run_queue;
+        // actors that are queued or running
+        std::size_t active = 0;
+        bool stopping = false;
+        std::vector<std::thread> threads;
+
+        void submit(actor &a, bool fresh)
+        {
+            {
+                std::lock_guard<std::mutex> lg(m);
+                run_queue.push_back(a);
+                if (fresh)
+                    active++;
+            }
+            work_cv.notify_one();
+        }
+
+        static void drain(actor &a) noexcept
+        {
+            actor_message *chain = a.mailbox.exchange(nullptr, std::memory_order_acquire);
+            list<actor_message, actor_message_tag> batch;
+            for (; chain != nullptr; chain = chain->mailbox_next)
+                batch.push_front(*chain);
+            a.inbox.splice(a.inbox.end(), batch, batch.begin(), batch.end());
+        }
+
+        void turn(actor &a)
+        {
+            drain(a);
+            for (std::size_t i = 0; i != quantum && !a.inbox.empty(); ++i)
+            {
+                actor_message &msg = a.inbox.front();
+                a.inbox.pop_front();
+                a.receive(msg);
+            }
+            if (!a.inbox.empty() || a.mailbox.load(std::memory_order_relaxed) != nullptr)
+            {
+                submit(a, false);
+                return;
+            }
+            a.scheduled.store(false);
+            // a sender may have pushed after the check above and seen scheduled still set
+            if (a.mailbox.load() != nullptr && !a.scheduled.exchange(true))
+            {
+                submit(a, false);
+                return;
+            }
+            std::lock_guard<std::mutex> lg(m);
+            if (--active == 0)
+                idle_cv.notify_all();
+        }
+
+        void thread_main()
+        {
+            std::unique_lock<std::mutex> lk(m);
+            for (;;)
+            {
+                work_cv.wait(lk, [&] { return stopping || !run_queue.empty(); });
+                if (run_queue.empty())
+                    return;
+                actor &a = run_queue.front();
+                run_queue.pop_front();
+                lk.unlock();
+                turn(a);
+                lk.lock();
+            }
+        }
+    public:
+        explicit actor_system(std::size_t threads_count = std::thread::hardware_concurrency(),
+                              std::size_t quantum = 64)
+            : quantum(quantum == 0 ? 1 : quantum)
+        {
+            if (threads_count == 0)
+                threads_count = 1;
+            for (std::size_t i = 0; i != threads_count; ++i)
+                threads.emplace_back([this] { thread_main(); });
+        }
+        actor_system(actor_system const&) = delete;
+        actor_system& operator=(actor_system const&) = delete;
+        // finishes the queued work first
+        ~actor_system()
+        {
+            wait_idle();
+            {
+                std::lock_guard<std::mutex> lg(m);
+                stopping = true;
+            }
+            work_cv.notify_all();
+            for (auto &t : threads)
+                t.join();
+        }
+
+        // m must stay alive until the target has received it
+        void send(actor &target, actor_message &msg)
+        {
+            assert(&target.sys == this);
+            actor_message *head = target.mailbox.load(std::memory_order_relaxed);
+            do
+                msg.mailbox_next = head;
+            while (!target.mailbox.compare_exchange_weak(head, &msg));
+            if (!target.scheduled.exchange(true))
+                submit(target, true);
+        }
+
+        // blocks until no actor has messages left
+        void wait_idle()
+        {
+            std::unique_lock<std::mutex> lk(m);
+            idle_cv.wait(lk, [&] { return active == 0; });
+        }
+    };
+}
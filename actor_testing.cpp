@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "actor.h"
+
+namespace
+{
+    struct number : intrusive::actor_message
+    {
+        int value = 0;
+        int sender = 0;
+    };
+
+    struct collector : intrusive::actor
+    {
+        using actor::actor;
+
+        void receive(intrusive::actor_message &m) override
+        {
+            auto &n = static_cast<number&>(m);
+            received.push_back(n.value);
+            senders.push_back(n.sender);
+        }
+
+        std::vector<int> received;
+        std::vector<int> senders;
+    };
+
+    struct token : intrusive::actor_message
+    {
+        int hops_left = 0;
+    };
+
+    // forwards a token to the next actor of the ring until it runs out of hops
+    struct ring_node : intrusive::actor
+    {
+        using actor::actor;
+
+        void receive(intrusive::actor_message &m) override
+        {
+            auto &t = static_cast<token&>(m);
+            handled++;
+            if (t.hops_left-- == 0)
+            {
+                finished->fetch_add(1);
+                return;
+            }
+            system().send(*next, t);
+        }
+
+        ring_node *next = nullptr;
+        std::atomic<int> *finished = nullptr;
+        long handled = 0;
+    };
+}
+
+TEST(actor_testing, fifo_from_one_sender)
+{
+    intrusive::actor_system sys(2, 4);
+    collector c(sys);
+    std::vector<number> msgs(100);
+    for (int i = 0; i != 100; ++i)
+    {
+        msgs[i].value = i;
+        sys.send(c, msgs[i]);
+    }
+    sys.wait_idle();
+    ASSERT_EQ(100u, c.received.size());
+    for (int i = 0; i != 100; ++i)
+        EXPECT_EQ(i, c.received[i]);
+}
+
+TEST(actor_testing, idle_without_messages)
+{
+    intrusive::actor_system sys(2);
+    sys.wait_idle();
+}
+
+TEST(actor_testing, concurrent_senders)
+{
+    constexpr int senders = 4;
+    constexpr int per_sender = 5000;
+    intrusive::actor_system sys(3, 16);
+    collector c(sys);
+    std::vector<std::unique_ptr<number[]>> msgs;
+    for (int s = 0; s != senders; ++s)
+        msgs.emplace_back(new number[per_sender]);
+
+    std::vector<std::thread> threads;
+    for (int s = 0; s != senders; ++s)
+        threads.emplace_back([&, s] {
+            for (int i = 0; i != per_sender; ++i)
+            {
+                msgs[s][i].value = i;
+                msgs[s][i].sender = s;
+                sys.send(c, msgs[s][i]);
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+    sys.wait_idle();
+
+    ASSERT_EQ(static_cast<std::size_t>(senders * per_sender), c.received.size());
+    // per sender order is kept
+    std::vector<int> last(senders, -1);
+    for (std::size_t i = 0; i != c.received.size(); ++i)
+    {
+        EXPECT_LT(last[c.senders[i]], c.received[i]);
+        last[c.senders[i]] = c.received[i];
+    }
+}
+
+TEST(actor_testing, ring)
+{
+    constexpr int actors = 1000;
+    constexpr int tokens = 50;
+    constexpr int hops = 2000;
+    intrusive::actor_system sys(4, 8);
+    std::atomic<int> finished{0};
+    std::vector<std::unique_ptr<ring_node>> ring;
+    for (int i = 0; i != actors; ++i)
+        ring.push_back(std::make_unique<ring_node>(sys));
+    for (int i = 0; i != actors; ++i)
+    {
+        ring[i]->next = ring[(i + 1) % actors].get();
+        ring[i]->finished = &finished;
+    }
+
+    std::vector<token> msgs(tokens);
+    for (int i = 0; i != tokens; ++i)
+    {
+        msgs[i].hops_left = hops;
+        sys.send(*ring[i * actors / tokens], msgs[i]);
+    }
+    sys.wait_idle();
+
+    EXPECT_EQ(tokens, finished.load());
+    long total = 0;
+    for (auto &a : ring)
+        total += a->handled;
+    EXPECT_EQ(static_cast<long>(tokens) * (hops + 1), total);
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+#include <sys/uio.h>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct log_record_tag;
+    struct log_producer_tag;
+
+    // Preallocated log line. The hook keeps it on the shared free list;
+    // `next` chains it in a producer's cache or pending stack.
+    struct log_record : list_element<log_record_tag>
+    {
+        static constexpr std::size_t capacity = 240;
+
+        std::atomic<log_record*> next{nullptr};
+        std::size_t length = 0;
+        char text[capacity];
+    };
+
+    // Logger whose hot path never touches a shared lock.
+    // Each thread pushes records onto the lock-free pending stack of its
+    // own producer; a background flusher takes the whole stack with one
+    // exchange, writes it in order with writev and gives the records back
+    // through a shared free list. Producers refill a small cache from that
+    // list once per refill_batch lines; when the list runs dry the flusher
+    // takes the caches back, so idle threads do not sit on free records.
+    // Lines that find no free record are dropped and counted.
+    class async_logger
+    {
+    public:
+        // Per-thread handle; log() uses atomics the flusher alone competes for.
+        class producer : public list_element<log_producer_tag>
+        {
+        private:
+            friend class async_logger;
+
+            async_logger *logger;
+            // popped only by the owner, emptied by the flusher
+            std::atomic<log_record*> cache{nullptr};
+            // newest first, pushed only by the owner, taken by the flusher
+            std::atomic<log_record*> pending{nullptr};
+
+            log_record *acquire() noexcept
+            {
+                log_record *r = cache.load(std::memory_order_acquire);
+                // only the owner fills the cache, so a stolen r never comes
+                // back here and the exchange fails on it
+                while (r != nullptr
+                       && !cache.compare_exchange_weak(r, r->next.load(std::memory_order_relaxed),
+                                                       std::memory_order_acquire))
+                    ;
+                if (r == nullptr)
+                    r = logger->refill(cache);
+                if (r == nullptr)
+                {
+                    logger->dropped_.fetch_add(1, std::memory_order_relaxed);
+                    logger->starved.store(true, std::memory_order_relaxed);
+                }
+                return r;
+            }
+
+            void publish(log_record &r) noexcept
+            {
+                log_record *head = pending.load(std::memory_order_relaxed);
+                do
+                    r.next.store(head, std::memory_order_relaxed);
+                while (!pending.compare_exchange_weak(head, &r, std::memory_order_release,
+                                                      std::memory_order_relaxed));
+            }
+        public:
+            explicit producer(async_logger &logger)
+                : logger(&logger)
+            {
+                std::lock_guard<std::mutex> lg(logger.flush_mutex);
+                logger.producers.push_back(*this);
+            }
+            producer(producer const&) = delete;
+            producer& operator=(producer const&) = delete;
+            ~producer()
+            {
+                std::lock_guard<std::mutex> lg(logger->flush_mutex);
+                logger->drain(*this, true);
+                unlink();
+            }
+
+            // logs one line, a newline is appended; long lines are truncated
+            void log(std::string_view line) noexcept
+            {
+                log_record *r = acquire();
+                if (r == nullptr)
+                    return;
+                std::size_t n = std::min(line.size(), log_record::capacity - 1);
+                std::memcpy(r->text, line.data(), n);
+                r->text[n] = '\n';
+                r->length = n + 1;
+                publish(*r);
+            }
+
+            // printf-style log()
+#if defined(__GNUC__) || defined(__clang__)
+            __attribute__((format(printf, 2, 3)))
+#endif
+            void logf(char const *fmt, ...) noexcept
+            {
+                log_record *r = acquire();
+                if (r == nullptr)
+                    return;
+                std::va_list args;
+                va_start(args, fmt);
+                int n = std::vsnprintf(r->text, log_record::capacity, fmt, args);
+                va_end(args);
+                std::size_t len = n < 0 ? 0 : std::min(static_cast<std::size_t>(n), log_record::capacity - 1);
+                r->text[len] = '\n';
+                r->length = len + 1;
+                publish(*r);
+            }
+        };
+
+    private:
+        static constexpr std::size_t refill_batch = 32;
+        static constexpr std::size_t iov_batch = 64;
+
+        int fd;
+        std::chrono::milliseconds interval;
+        std::unique_ptr<log_record[]> records;
+
+        std::mutex free_mutex;
+        list<log_record, log_record_tag> free_records;
+        // a line was dropped, the flusher takes the producers' caches back
+        std::atomic<bool> starved{false};
+
+        // guards the producer registry and the output fd
+        std::mutex flush_mutex;
+        list<producer, log_producer_tag> producers;
+
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::atomic<std::size_t> dropped_{0};
+        std::thread flusher;
+
+        // returns one free record and chains up to refill_batch - 1 more
+        // into the empty cache, nullptr when there is none
+        log_record *refill(std::atomic<log_record*> &cache) noexcept
+        {
+            std::lock_guard<std::mutex> lg(free_mutex);
+            if (free_records.empty())
+                return nullptr;
+            log_record &r = free_records.front();
+            free_records.pop_front();
+            log_record *chain = nullptr;
+            for (std::size_t i = 1; i != refill_batch && !free_records.empty(); ++i)
+            {
+                log_record &c = free_records.front();
+                free_records.pop_front();
+                c.next.store(chain, std::memory_order_relaxed);
+                chain = &c;
+            }
+            cache.store(chain, std::memory_order_release);
+            return &r;
+        }
+
+        void write_all(iovec *iov, int cnt) noexcept
+        {
+            while (cnt != 0)
+            {
+                ssize_t n = ::writev(fd, iov, cnt);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    return;
+                }
+                auto left = static_cast<std::size_t>(n);
+                while (cnt != 0 && left >= iov->iov_len)
+                {
+                    left -= iov->iov_len;
+                    ++iov;
+                    --cnt;
+                }
+                if (cnt != 0)
+                {
+                    iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+                    iov->iov_len -= left;
+                }
+            }
+        }
+
+        // writes the records and moves them to the free list, flush_mutex held
+        void write_out(list<log_record, log_record_tag> &batch) noexcept
+        {
+            if (batch.empty())
+                return;
+            iovec iov[iov_batch];
+            int cnt = 0;
+            for (auto it = batch.begin(); it != batch.end(); ++it)
+            {
+                iov[cnt].iov_base = it->text;
+                iov[cnt].iov_len = it->length;
+                if (++cnt == static_cast<int>(iov_batch))
+                {
+                    write_all(iov, cnt);
+                    cnt = 0;
+                }
+            }
+            write_all(iov, cnt);
+
+            std::lock_guard<std::mutex> lg(free_mutex);
+            free_records.splice(free_records.end(), batch, batch.begin(), batch.end());
+        }
+
+        void drain(producer &p, bool take_cache) noexcept;
+        void drain_locked() noexcept;
+
+        void run() noexcept
+        {
+            std::unique_lock<std::mutex> lk(wake_mutex);
+            while (!stopping)
+            {
+                wake.wait_for(lk, interval);
+                lk.unlock();
+                flush();
+                lk.lock();
+            }
+        }
+    public:
+        // fd is not owned; interval is the longest time a line stays buffered
+        explicit async_logger(int fd, std::size_t record_count = 4096,
+                              std::chrono::milliseconds interval = std::chrono::milliseconds(10))
+            : fd(fd)
+            , interval(interval)
+            , records(new log_record[record_count])
+        {
+            for (std::size_t i = 0; i != record_count; ++i)
+                free_records.push_back(records[i]);
+            flusher = std::thread([this] { run(); });
+        }
+        async_logger(async_logger const&) = delete;
+        async_logger& operator=(async_logger const&) = delete;
+
+        // all producers must be destroyed before the logger
+        ~async_logger()
+        {
+            {
+                std::lock_guard<std::mutex> lg(wake_mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            flusher.join();
+            flush();
+        }
+
+        // synchronously writes everything logged so far
+        void flush() noexcept
+        {
+            std::lock_guard<std::mutex> lg(flush_mutex);
+            drain_locked();
+        }
+
+        std::size_t dropped() const noexcept
+        {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+    };
+
+    // writes the pending lines of p and optionally takes back its cache,
+    // flush_mutex held
+    inline void async_logger::drain(producer &p, bool take_cache) noexcept
+    {
+        list<log_record, log_record_tag> batch;
+        // pushing each to the front restores the order they were logged in
+        log_record *r = p.pending.exchange(nullptr, std::memory_order_acquire);
+        while (r != nullptr)
+        {
+            log_record *next = r->next.load(std::memory_order_relaxed);
+            batch.push_front(*r);
+            r = next;
+        }
+        write_out(batch);
+        if (!take_cache)
+            return;
+        r = p.cache.exchange(nullptr, std::memory_order_acquire);
+        if (r == nullptr)
+            return;
+        std::lock_guard<std::mutex> lg(free_mutex);
+        while (r != nullptr)
+        {
+            log_record *next = r->next.load(std::memory_order_relaxed);
+            free_records.push_back(*r);
+            r = next;
+        }
+    }
+
+    inline void async_logger::drain_locked() noexcept
+    {
+        bool take_caches = starved.exchange(false, std::memory_order_relaxed);
+        for (auto it = producers.begin(); it != producers.end(); ++it)
+            drain(*it, take_caches);
+    }
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "async_logger.h"
+#include "test_utils.h"
+
+TEST(async_logger_testing, single_producer)
+{
+    temp_file f;
+    {
+        intrusive::async_logger logger(f.fd());
+        intrusive::async_logger::producer p(logger);
+        p.log("hello");
+        p.logf("%d %s", 42, "world");
+        logger.flush();
+        EXPECT_EQ("hello\n42 world\n", f.contents());
+    }
+}
+
+TEST(async_logger_testing, truncate)
+{
+    temp_file f;
+    {
+        intrusive::async_logger logger(f.fd());
+        intrusive::async_logger::producer p(logger);
+        p.log(std::string(1000, 'x'));
+    }
+    std::string expected(intrusive::log_record::capacity - 1, 'x');
+    EXPECT_EQ(expected + "\n", f.contents());
+}
+
+TEST(async_logger_testing, drop_when_exhausted)
+{
+    temp_file f;
+    {
+        intrusive::async_logger logger(f.fd(), 4, std::chrono::hours(1));
+        intrusive::async_logger::producer p(logger);
+        for (int i = 0; i != 6; ++i)
+            p.log("line");
+        EXPECT_EQ(2u, logger.dropped());
+        logger.flush();
+        p.log("again");
+    }
+    EXPECT_EQ("line\nline\nline\nline\nagain\n", f.contents());
+}
+
+TEST(async_logger_testing, idle_cache_returned)
+{
+    temp_file f;
+    {
+        intrusive::async_logger logger(f.fd(), 40, std::chrono::hours(1));
+        intrusive::async_logger::producer idle(logger);
+        intrusive::async_logger::producer busy(logger);
+        // the idle producer keeps most of the records in its cache
+        idle.log("idle");
+        logger.flush();
+        for (int i = 0; i != 20; ++i)
+            busy.log("busy");
+        std::size_t dropped = logger.dropped();
+        EXPECT_LT(0u, dropped);
+        // the flush after a drop takes the idle cache back
+        logger.flush();
+        for (int i = 0; i != 20; ++i)
+            busy.log("busy");
+        EXPECT_EQ(dropped, logger.dropped());
+    }
+}
+
+TEST(async_logger_testing, many_threads)
+{
+    constexpr int threads_count = 8;
+    constexpr int lines = 2000;
+    temp_file f;
+    {
+        intrusive::async_logger logger(f.fd(), threads_count * lines, std::chrono::milliseconds(1));
+        std::vector<std::thread> threads;
+        for (int t = 0; t != threads_count; ++t)
+            threads.emplace_back([&logger, t] {
+                intrusive::async_logger::producer p(logger);
+                for (int i = 0; i != lines; ++i)
+                    p.logf("%d:%d", t, i);
+            });
+        for (auto &t : threads)
+            t.join();
+        EXPECT_EQ(0u, logger.dropped());
+    }
+
+    std::string out = f.contents();
+    EXPECT_EQ(threads_count * lines, std::count(out.begin(), out.end(), '\n'));
+    // lines of one producer keep their order
+    std::size_t prev = 0;
+    for (int i = 0; i != lines; ++i)
+    {
+        std::size_t pos = out.find("\n3:" + std::to_string(i) + "\n");
+        if (pos == std::string::npos && out.compare(0, 3, "3:") == 0)
+            pos = 0;
+        ASSERT_NE(std::string::npos, pos);
+        EXPECT_LE(prev, pos);
+        prev = pos;
+    }
+}
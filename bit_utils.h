@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace intrusive
+{
+    namespace detail
+    {
+        // index of the most significant set bit, x != 0
+        inline unsigned bit_fls(std::size_t x) noexcept
+        {
+            assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(x));
+#else
+            unsigned r = 0;
+            while (x >>= 1)
+                r++;
+            return r;
+#endif
+        }
+
+        // index of the least significant set bit, x != 0
+        inline unsigned bit_ffs(std::uint64_t x) noexcept
+        {
+            assert(x != 0);
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+            unsigned r = 0;
+            while ((x & 1) == 0)
+            {
+                x >>= 1;
+                r++;
+            }
+            return r;
+#endif
+        }
+    }
+}
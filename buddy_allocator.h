@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include "bit_utils.h"
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    // Binary buddy allocator over a caller-provided pool.
+    // Free blocks embed a list_element and live in one intrusive list per order;
+    // the state of every min_block-sized unit is tracked in a bitmap, so a free
+    // buddy is found and unlinked in O(1) when merging.
+    // The pool must outlive the allocator.
+    class buddy_allocator
+    {
+    private:
+        struct free_tag;
+
+        struct free_block : list_element<free_tag>
+        {};
+
+        static constexpr unsigned max_orders = 64;
+
+        char *base = nullptr;
+        std::size_t min_block;
+        unsigned min_block_log2;
+        std::size_t units = 0;
+        // bit set iff the unit starts a free block
+        std::vector<std::uint64_t> free_bitmap;
+        // order of the block starting at the unit, valid for block heads only
+        std::vector<unsigned char> orders;
+        // bit set iff free_lists[order] is not empty
+        std::uint64_t order_mask = 0;
+        std::array<list<free_block, free_tag>, max_orders> free_lists;
+
+        bool is_free(std::size_t unit) const noexcept
+        {
+            return (free_bitmap[unit / 64] >> (unit % 64)) & 1;
+        }
+        void set_free(std::size_t unit, bool f) noexcept
+        {
+            if (f)
+                free_bitmap[unit / 64] |= std::uint64_t(1) << (unit % 64);
+            else
+                free_bitmap[unit / 64] &= ~(std::uint64_t(1) << (unit % 64));
+        }
+
+        free_block &block_at(std::size_t unit) noexcept
+        {
+            return *std::launder(reinterpret_cast<free_block*>(base + (unit << min_block_log2)));
+        }
+
+        void push_free(std::size_t unit, unsigned order) noexcept
+        {
+            auto *b = ::new (static_cast<void*>(base + (unit << min_block_log2))) free_block;
+            free_lists[order].push_back(*b);
+            order_mask |= std::uint64_t(1) << order;
+            orders[unit] = static_cast<unsigned char>(order);
+            set_free(unit, true);
+        }
+
+        void remove_free(std::size_t unit, unsigned order) noexcept
+        {
+            block_at(unit).unlink();
+            if (free_lists[order].empty())
+                order_mask &= ~(std::uint64_t(1) << order);
+            set_free(unit, false);
+        }
+
+        std::size_t unit_of(void const *p) const noexcept
+        {
+            return static_cast<std::size_t>(static_cast<char const*>(p) - base) >> min_block_log2;
+        }
+    public:
+        // min_block must be a power of two not smaller than a list hook;
+        // the pool start is aligned up to min_block
+        buddy_allocator(void *pool, std::size_t bytes, std::size_t min_block = 4096)
+            : min_block(min_block)
+            , min_block_log2(detail::bit_fls(min_block))
+        {
+            assert((min_block & (min_block - 1)) == 0);
+            assert(min_block >= sizeof(free_block));
+            auto start = reinterpret_cast<std::uintptr_t>(pool);
+            auto aligned = (start + min_block - 1) & ~std::uintptr_t(min_block - 1);
+            if (bytes < aligned - start + min_block)
+                return;
+            base = reinterpret_cast<char*>(aligned);
+            units = (bytes - (aligned - start)) >> min_block_log2;
+            free_bitmap.assign((units + 63) / 64, 0);
+            orders.assign(units, 0);
+
+            // carve the pool into naturally aligned blocks of decreasing size
+            std::size_t unit = 0;
+            while (unit != units)
+            {
+                unsigned order = detail::bit_fls(units - unit);
+                push_free(unit, order);
+                unit += std::size_t(1) << order;
+            }
+        }
+
+        buddy_allocator(buddy_allocator const&) = delete;
+        buddy_allocator& operator=(buddy_allocator const&) = delete;
+
+        // returns a block of at least bytes, aligned to min_block, or nullptr
+        void *allocate(std::size_t bytes) noexcept
+        {
+            if (bytes == 0)
+                return nullptr;
+            std::size_t need = (bytes + min_block - 1) >> min_block_log2;
+            unsigned order = need == 1 ? 0 : detail::bit_fls(need - 1) + 1;
+            if (order >= max_orders)
+                return nullptr;
+            std::uint64_t candidates = order_mask & (~std::uint64_t(0) << order);
+            if (candidates == 0)
+                return nullptr;
+            unsigned k = detail::bit_ffs(candidates);
+            std::size_t unit = unit_of(&free_lists[k].front());
+            remove_free(unit, k);
+            while (k != order)
+            {
+                k--;
+                push_free(unit + (std::size_t(1) << k), k);
+            }
+            orders[unit] = static_cast<unsigned char>(order);
+            return base + (unit << min_block_log2);
+        }
+
+        void deallocate(void *p) noexcept
+        {
+            if (p == nullptr)
+                return;
+            std::size_t unit = unit_of(p);
+            assert(unit < units && !is_free(unit));
+            unsigned order = orders[unit];
+            for (;;)
+            {
+                std::size_t buddy = unit ^ (std::size_t(1) << order);
+                if (buddy >= units || !is_free(buddy) || orders[buddy] != order)
+                    break;
+                remove_free(buddy, order);
+                if (buddy < unit)
+                    unit = buddy;
+                order++;
+            }
+            push_free(unit, order);
+        }
+
+        // size of the block backing p
+        std::size_t block_size(void const *p) const noexcept
+        {
+            return min_block << orders[unit_of(p)];
+        }
+
+        std::size_t free_bytes() const noexcept
+        {
+            std::size_t res = 0;
+            for (unsigned k = 0; k != max_orders; ++k)
+                for (auto it = free_lists[k].begin(); it != free_lists[k].end(); ++it)
+                    res += min_block << k;
+            return res;
+        }
+
+        // size of the largest block allocate() can currently return
+        std::size_t largest_free_block() const noexcept
+        {
+            if (order_mask == 0)
+                return 0;
+            return min_block << detail::bit_fls(order_mask);
+        }
+    };
+}
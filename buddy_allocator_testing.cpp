@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include "buddy_allocator.h"
+
+namespace
+{
+    constexpr std::size_t pool_size = 1 << 22;
+
+    struct pool
+    {
+        pool()
+            : data(new unsigned char[pool_size + 4096])
+        {}
+
+        unsigned char *get() const noexcept
+        {
+            auto x = reinterpret_cast<std::uintptr_t>(data.get());
+            return reinterpret_cast<unsigned char*>((x + 4095) & ~std::uintptr_t(4095));
+        }
+
+        std::unique_ptr<unsigned char[]> data;
+    };
+}
+
+TEST(buddy_allocator_testing, allocate_01)
+{
+    pool p;
+    intrusive::buddy_allocator a(p.get(), pool_size);
+    void *x = a.allocate(100);
+    ASSERT_NE(nullptr, x);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(x) % 4096);
+    EXPECT_EQ(4096u, a.block_size(x));
+    void *y = a.allocate(4097);
+    ASSERT_NE(nullptr, y);
+    EXPECT_EQ(8192u, a.block_size(y));
+    a.deallocate(x);
+    a.deallocate(y);
+    EXPECT_EQ(pool_size, a.largest_free_block());
+    EXPECT_EQ(pool_size, a.free_bytes());
+}
+
+TEST(buddy_allocator_testing, split_merge)
+{
+    pool p;
+    intrusive::buddy_allocator a(p.get(), pool_size);
+    std::vector<void*> blocks;
+    while (void *x = a.allocate(1 << 20))
+        blocks.push_back(x);
+    EXPECT_EQ(pool_size >> 20, blocks.size());
+    EXPECT_EQ(0u, a.free_bytes());
+    EXPECT_EQ(nullptr, a.allocate(1));
+
+    a.deallocate(blocks[1]);
+    a.deallocate(blocks[2]);
+    // 1 and 2 are not buddies
+    EXPECT_EQ(1u << 20, a.largest_free_block());
+    a.deallocate(blocks[3]);
+    EXPECT_EQ(2u << 20, a.largest_free_block());
+    a.deallocate(blocks[0]);
+    EXPECT_EQ(4u << 20, a.largest_free_block());
+}
+
+TEST(buddy_allocator_testing, non_power_of_two_pool)
+{
+    pool p;
+    intrusive::buddy_allocator a(p.get(), 13 * 4096 + 100);
+    EXPECT_EQ(13u * 4096, a.free_bytes());
+    EXPECT_EQ(8u * 4096, a.largest_free_block());
+
+    std::vector<void*> blocks;
+    while (void *x = a.allocate(4096))
+        blocks.push_back(x);
+    EXPECT_EQ(13u, blocks.size());
+    for (void *x : blocks)
+        a.deallocate(x);
+    EXPECT_EQ(13u * 4096, a.free_bytes());
+    EXPECT_EQ(8u * 4096, a.largest_free_block());
+}
+
+TEST(buddy_allocator_testing, random)
+{
+    pool p;
+    intrusive::buddy_allocator a(p.get(), pool_size);
+    std::mt19937 rng(7);
+    struct block
+    {
+        unsigned char *data;
+        std::size_t size;
+        unsigned char fill;
+    };
+    std::vector<block> live;
+
+    for (int i = 0; i != 5000; ++i)
+    {
+        if (live.empty() || rng() % 2 == 0)
+        {
+            std::size_t size = std::size_t(4096) << (rng() % 9);
+            size -= rng() % 2048;
+            auto *x = static_cast<unsigned char*>(a.allocate(size));
+            if (x == nullptr)
+                continue;
+            auto fill = static_cast<unsigned char>(i);
+            std::memset(x, fill, size);
+            live.push_back({x, size, fill});
+        }
+        else
+        {
+            std::swap(live[rng() % live.size()], live.back());
+            block b = live.back();
+            live.pop_back();
+            ASSERT_EQ(b.data + b.size, std::find_if(b.data, b.data + b.size,
+                                                    [&](unsigned char c) { return c != b.fill; }));
+            a.deallocate(b.data);
+        }
+    }
+    for (block const& b : live)
+        a.deallocate(b.data);
+    EXPECT_EQ(pool_size, a.largest_free_block());
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    // default priority of a calendar_queue element: its public `time` member
+    struct calendar_time
+    {
+        template <typename T>
+        double operator()(T const& e) const noexcept
+        {
+            return e.time;
+        }
+    };
+
+    // Brown's calendar queue: a priority queue for event simulation with
+    // O(1) expected enqueue and dequeue. Time is cut into days of `width`;
+    // day d lives in bucket d mod bucket count, a sorted intrusive list, so
+    // a year of buckets is scanned like a desk calendar. The bucket count
+    // doubles or halves with the size and the day width is re-estimated
+    // from the gaps between the earliest events; redistribution gathers
+    // all buckets into one list with splices and reinserts from there.
+    // Elements with equal time come out in insertion order.
+    template <typename T, typename Tag = default_tag, typename GetTime = calendar_time>
+    class calendar_queue
+    {
+    private:
+        static constexpr std::size_t min_buckets = 2;
+        static constexpr std::size_t sample_size = 25;
+
+        using bucket = list<T, Tag>;
+
+        GetTime time_of;
+        std::vector<bucket> buckets;
+        std::size_t mask;
+        double width;
+        std::size_t size_ = 0;
+        // the day being scanned, nothing earlier is queued
+        std::int64_t current_day = 0;
+
+        std::int64_t day_of(double t) const noexcept
+        {
+            return static_cast<std::int64_t>(std::floor(t / width));
+        }
+        bucket &bucket_of(std::int64_t day) noexcept
+        {
+            return buckets[static_cast<std::uint64_t>(day) & mask];
+        }
+
+        void insert_sorted(T &e) noexcept
+        {
+            double t = time_of(e);
+            bucket &b = bucket_of(day_of(t));
+            // events mostly arrive late, search from the back
+            auto pos = b.end();
+            while (pos != b.begin())
+            {
+                auto prev = std::prev(pos);
+                if (time_of(*prev) <= t)
+                    break;
+                pos = prev;
+            }
+            b.insert(pos, e);
+        }
+
+        // finds the bucket holding the earliest element, queue not empty
+        bucket &find_min() noexcept
+        {
+            assert(size_ != 0);
+            std::int64_t day = current_day;
+            for (std::size_t i = 0; i != buckets.size(); ++i, ++day)
+            {
+                bucket &b = bucket_of(day);
+                if (!b.empty() && day_of(time_of(b.front())) <= day)
+                {
+                    current_day = day;
+                    return b;
+                }
+            }
+            // a sparse year, fall back to a direct search over all fronts
+            bucket *best = nullptr;
+            for (auto &b : buckets)
+                if (!b.empty() && (best == nullptr || time_of(b.front()) < time_of(best->front())))
+                    best = &b;
+            current_day = day_of(time_of(best->front()));
+            return *best;
+        }
+
+        // average gap between the earliest events, ignoring outliers
+        double estimate_width()
+        {
+            std::size_t n = size_ < sample_size ? size_ : sample_size;
+            if (n < 2)
+                return width;
+            std::vector<T*> sample;
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                T &e = find_min().front();
+                static_cast<list_element<Tag>&>(e).unlink();
+                size_--;
+                sample.push_back(&e);
+            }
+            double total = 0;
+            for (std::size_t i = 1; i != n; ++i)
+                total += time_of(*sample[i]) - time_of(*sample[i - 1]);
+            double avg = total / static_cast<double>(n - 1);
+            double kept = 0;
+            std::size_t kept_count = 0;
+            for (std::size_t i = 1; i != n; ++i)
+            {
+                double gap = time_of(*sample[i]) - time_of(*sample[i - 1]);
+                if (gap <= 2 * avg)
+                {
+                    kept += gap;
+                    kept_count++;
+                }
+            }
+            // put the sample back in its old order to keep ties stable
+            for (std::size_t i = n; i-- != 0;)
+            {
+                bucket &b = bucket_of(day_of(time_of(*sample[i])));
+                b.push_front(*sample[i]);
+                size_++;
+            }
+            double w = kept_count == 0 ? 0 : 3 * kept / static_cast<double>(kept_count);
+            return w > 0 ? w : width;
+        }
+
+        void resize(std::size_t new_count)
+        {
+            double new_width = estimate_width();
+
+            bucket all;
+            for (auto &b : buckets)
+                all.splice(all.end(), b, b.begin(), b.end());
+            // buckets hold disjoint days and are sorted, but interleave; reinsert
+            std::vector<bucket> fresh(new_count);
+            buckets.swap(fresh);
+            mask = new_count - 1;
+            width = new_width;
+            double first = all.empty() ? 0 : time_of(all.front());
+            std::size_t n = size_;
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                T &e = all.front();
+                all.pop_front();
+                if (time_of(e) < first)
+                    first = time_of(e);
+                insert_sorted(e);
+            }
+            current_day = day_of(first);
+        }
+    public:
+        // initial_width should be close to the typical gap between events
+        explicit calendar_queue(double initial_width = 1.0, GetTime get_time = GetTime())
+            : time_of(get_time)
+            , buckets(min_buckets)
+            , mask(min_buckets - 1)
+            , width(initial_width)
+        {
+            assert(initial_width > 0);
+        }
+        calendar_queue(calendar_queue const&) = delete;
+        calendar_queue& operator=(calendar_queue const&) = delete;
+
+        bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+        std::size_t size() const noexcept
+        {
+            return size_;
+        }
+        std::size_t bucket_count() const noexcept
+        {
+            return buckets.size();
+        }
+
+        void push(T &e)
+        {
+            double t = time_of(e);
+            if (size_ == 0 || day_of(t) < current_day)
+                current_day = day_of(t);
+            insert_sorted(e);
+            size_++;
+            if (size_ > 2 * buckets.size())
+                resize(2 * buckets.size());
+        }
+
+        T &top() noexcept
+        {
+            return find_min().front();
+        }
+
+        T &pop()
+        {
+            bucket &b = find_min();
+            T &e = b.front();
+            b.pop_front();
+            size_--;
+            if (buckets.size() > min_buckets && size_ < buckets.size() / 2)
+                resize(buckets.size() / 2);
+            return e;
+        }
+
+        // removes e wherever it is, e.g. a cancelled event
+        void erase(T &e) noexcept
+        {
+            assert(static_cast<list_element<Tag>&>(e).is_linked());
+            static_cast<list_element<Tag>&>(e).unlink();
+            size_--;
+        }
+
+        void clear() noexcept
+        {
+            for (auto &b : buckets)
+                b.clear();
+            size_ = 0;
+        }
+    };
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <queue>
+#include <random>
+#include <utility>
+#include <vector>
+#include "calendar_queue.h"
+
+namespace
+{
+    struct event : intrusive::list_element<>
+    {
+        double time = 0;
+        int id = 0;
+    };
+
+    struct job_tag;
+
+    struct job : intrusive::list_element<job_tag>
+    {
+        long deadline = 0;
+    };
+
+    struct job_deadline
+    {
+        double operator()(job const& j) const noexcept
+        {
+            return static_cast<double>(j.deadline);
+        }
+    };
+
+    using queue_type = intrusive::calendar_queue<event>;
+
+    // (time, id) pairs in the order std::priority_queue would give for unique ids
+    using reference_queue = std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>,
+                                                std::greater<std::pair<double, int>>>;
+}
+
+TEST(calendar_queue_testing, empty)
+{
+    queue_type q;
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(0u, q.size());
+}
+
+TEST(calendar_queue_testing, ordered)
+{
+    std::vector<event> events(5);
+    double times[] = {3.5, 0.25, 10, 2, 7};
+    queue_type q(1.0);
+    for (int i = 0; i != 5; ++i)
+    {
+        events[i].time = times[i];
+        events[i].id = i;
+        q.push(events[i]);
+    }
+    EXPECT_EQ(5u, q.size());
+    EXPECT_EQ(1, q.top().id);
+    std::vector<double> out;
+    while (!q.empty())
+        out.push_back(q.pop().time);
+    EXPECT_EQ((std::vector<double>{0.25, 2, 3.5, 7, 10}), out);
+}
+
+TEST(calendar_queue_testing, ties_keep_insertion_order)
+{
+    std::vector<event> events(100);
+    queue_type q(0.5);
+    for (int i = 0; i != 100; ++i)
+    {
+        events[i].time = (i % 4) * 10;
+        events[i].id = i;
+        q.push(events[i]);
+    }
+    int last_id[4] = {-1, -1, -1, -1};
+    double last_time = -1;
+    while (!q.empty())
+    {
+        event &e = q.pop();
+        EXPECT_LE(last_time, e.time);
+        last_time = e.time;
+        int k = e.id % 4;
+        EXPECT_LT(last_id[k], e.id);
+        last_id[k] = e.id;
+    }
+}
+
+TEST(calendar_queue_testing, erase)
+{
+    std::vector<event> events(10);
+    queue_type q;
+    for (int i = 0; i != 10; ++i)
+    {
+        events[i].time = i;
+        events[i].id = i;
+        q.push(events[i]);
+    }
+    q.erase(events[0]);
+    q.erase(events[5]);
+    EXPECT_EQ(8u, q.size());
+    std::vector<int> ids;
+    while (!q.empty())
+        ids.push_back(q.pop().id);
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 6, 7, 8, 9}), ids);
+}
+
+TEST(calendar_queue_testing, grows_and_shrinks)
+{
+    std::vector<event> events(1000);
+    queue_type q;
+    for (int i = 0; i != 1000; ++i)
+    {
+        events[i].time = i * 0.01;
+        events[i].id = i;
+        q.push(events[i]);
+    }
+    EXPECT_GE(q.bucket_count(), 256u);
+    for (int i = 0; i != 1000; ++i)
+        EXPECT_EQ(i, q.pop().id);
+    EXPECT_LE(q.bucket_count(), 4u);
+}
+
+TEST(calendar_queue_testing, custom_time_and_tag)
+{
+    std::vector<job> jobs(3);
+    intrusive::calendar_queue<job, job_tag, job_deadline> q(10.0);
+    jobs[0].deadline = 300;
+    jobs[1].deadline = -20;
+    jobs[2].deadline = 5;
+    for (auto &j : jobs)
+        q.push(j);
+    EXPECT_EQ(-20, q.pop().deadline);
+    EXPECT_EQ(5, q.pop().deadline);
+    EXPECT_EQ(300, q.pop().deadline);
+}
+
+TEST(calendar_queue_testing, hold_model)
+{
+    // classic hold model: pop the earliest event, reschedule it a random
+    // increment later, with a few distributions of increments
+    for (int dist = 0; dist != 3; ++dist)
+    {
+        std::mt19937 rng(static_cast<unsigned>(dist + 1));
+        std::exponential_distribution<double> expo(1.0);
+        std::uniform_real_distribution<double> uni(0.0, 2.0);
+        auto increment = [&] {
+            switch (dist)
+            {
+            case 0:
+                return expo(rng);
+            case 1:
+                return uni(rng);
+            default:
+                // bimodal
+                return rng() % 10 == 0 ? 100 + uni(rng) : uni(rng) * 0.01;
+            }
+        };
+
+        constexpr int n = 2000;
+        std::vector<event> events(n);
+        queue_type q;
+        reference_queue ref;
+        for (int i = 0; i != n; ++i)
+        {
+            events[i].time = increment();
+            events[i].id = i;
+            q.push(events[i]);
+            ref.push({events[i].time, i});
+        }
+        for (int step = 0; step != 50000; ++step)
+        {
+            event &e = q.pop();
+            ASSERT_EQ(ref.top().first, e.time);
+            ASSERT_EQ(ref.top().second, e.id);
+            ref.pop();
+            e.time += increment();
+            q.push(e);
+            ref.push({e.time, e.id});
+        }
+        while (!q.empty())
+        {
+            event &e = q.pop();
+            ASSERT_EQ(ref.top().second, e.id);
+            ref.pop();
+        }
+    }
+}
@@ -0,0 +1,382 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+
+#include "bit_utils.h"
+#include "epoch_reclaim.h"
+
+namespace intrusive
+{
+    template <typename T, typename Tag, std::size_t MaxHeight, typename KeyOf, typename Less, typename Reclaim>
+    class concurrent_skip_list;
+
+    // Tower hook for concurrent_skip_list: room for MaxHeight successors,
+    // of which an element uses the lowest `height`, drawn at insertion.
+    // The low bit of a successor marks the element as erased at that level.
+    template <typename Tag = default_tag, std::size_t MaxHeight = 16>
+    class skip_list_element : public reclaimable
+    {
+    private:
+        template <typename FT, typename FTag, std::size_t FMaxHeight, typename FKeyOf, typename FLess,
+                  typename FReclaim>
+        friend class concurrent_skip_list;
+        unsigned height = 0;
+        std::atomic<std::uintptr_t> next[MaxHeight] = {};
+    public:
+        skip_list_element() = default;
+        skip_list_element(skip_list_element const&) = delete;
+        skip_list_element& operator=(skip_list_element const&) = delete;
+    };
+
+    // Lock-free skip list after Fraser and Herlihy-Shavit: an ordered set
+    // whose elements are the caller's objects. An element is in the set
+    // once it is linked at the bottom level; the levels above are built
+    // afterwards and only speed up searches. Erase marks the tower from
+    // the top down, the mark at the bottom decides who erased it, and a
+    // search for the key unlinks it at every level. Searches that modify
+    // help unlink marked elements on their way; lower_bound, find and
+    // iteration only step over them. Erased elements are retired to the
+    // participant's epoch_domain and reach Reclaim once no thread can
+    // stand on them. The key of an element must not change while it is
+    // on the list.
+    template <typename T, typename Tag = default_tag, std::size_t MaxHeight = 16,
+              typename KeyOf = member_key, typename Less = std::less<>, typename Reclaim = no_reclaim>
+    class concurrent_skip_list
+    {
+    private:
+        static_assert(MaxHeight > 0 && MaxHeight <= 64, "tower height out of range");
+
+        using element = skip_list_element<Tag, MaxHeight>;
+        using participant = epoch_domain::participant;
+
+        static constexpr std::uintptr_t erased = 1;
+
+        KeyOf key_of;
+        Less less;
+        element head;
+        std::atomic<std::size_t> size_{0};
+
+        static element *ptr(std::uintptr_t w) noexcept
+        {
+            return reinterpret_cast<element*>(w & ~erased);
+        }
+        static std::uintptr_t word(element *e) noexcept
+        {
+            return reinterpret_cast<std::uintptr_t>(e);
+        }
+        static element &cast_el(T &r) noexcept
+        {
+            return static_cast<element&>(r);
+        }
+        static T const& cast_t(element const& e) noexcept
+        {
+            return static_cast<T const&>(e);
+        }
+
+        static void reclaim_element(reclaimable &r)
+        {
+            auto &e = static_cast<element&>(r);
+            for (unsigned l = 0; l != e.height; ++l)
+                e.next[l].store(0, std::memory_order_relaxed);
+            e.height = 0;
+            Reclaim()(static_cast<T&>(e));
+        }
+
+        // geometric with p = 1/2, from a per-thread xorshift generator
+        static unsigned random_height() noexcept
+        {
+            static thread_local std::uint64_t state = 0;
+            if (state == 0)
+                state = reinterpret_cast<std::uintptr_t>(&state) | 1;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return 1 + detail::bit_ffs(state | std::uint64_t(1) << (MaxHeight - 1));
+        }
+
+        // Fills preds and succs with the neighbours of key at every level,
+        // unlinking marked elements on the way; true when succs[0] has it.
+        template <typename K>
+        bool search(K const& key, element **preds, element **succs)
+        {
+            for (;;)
+            {
+                element *pred = &head;
+                bool restart = false;
+                for (std::size_t l = MaxHeight; l-- != 0 && !restart;)
+                {
+                    element *curr = ptr(pred->next[l].load());
+                    while (curr != nullptr)
+                    {
+                        std::uintptr_t w = curr->next[l].load();
+                        if (w & erased)
+                        {
+                            std::uintptr_t expected = word(curr);
+                            // fails when pred was erased or changed
+                            if (!pred->next[l].compare_exchange_strong(expected, w & ~erased))
+                            {
+                                restart = true;
+                                break;
+                            }
+                            curr = ptr(w);
+                            continue;
+                        }
+                        if (!less(key_of(cast_t(*curr)), key))
+                            break;
+                        pred = curr;
+                        curr = ptr(w);
+                    }
+                    preds[l] = pred;
+                    succs[l] = curr;
+                }
+                if (!restart)
+                    return succs[0] != nullptr && !less(key, key_of(cast_t(*succs[0])));
+            }
+        }
+
+        // first element at level 0 not before key, stepping over marked
+        // ones without unlinking them
+        template <typename K>
+        element *seek(K const& key) const
+        {
+            element const* pred = &head;
+            element *curr = nullptr;
+            for (std::size_t l = MaxHeight; l-- != 0;)
+            {
+                curr = ptr(pred->next[l].load());
+                while (curr != nullptr)
+                {
+                    std::uintptr_t w = curr->next[l].load();
+                    if ((w & erased) == 0)
+                    {
+                        if (!less(key_of(cast_t(*curr)), key))
+                            break;
+                        pred = curr;
+                    }
+                    curr = ptr(w);
+                }
+            }
+            return curr;
+        }
+
+        static element *skip_erased(element *e) noexcept
+        {
+            while (e != nullptr && (e->next[0].load() & erased))
+                e = ptr(e->next[0].load());
+            return e;
+        }
+
+        // links e above the bottom level, giving up once it gets erased
+        template <typename K>
+        void build_tower(element &e, K const& key, element **preds, element **succs)
+        {
+            for (unsigned l = 1; l != e.height; ++l)
+            {
+                for (;;)
+                {
+                    std::uintptr_t w = e.next[l].load();
+                    if (w & erased)
+                        return;
+                    if (ptr(w) != succs[l] && !e.next[l].compare_exchange_strong(w, word(succs[l])))
+                        continue;
+                    std::uintptr_t expected = word(succs[l]);
+                    if (preds[l]->next[l].compare_exchange_strong(expected, word(&e)))
+                        break;
+                    search(key, preds, succs);
+                    if (succs[0] != &e)
+                        return;
+                }
+                // an eraser that searched before this link cannot have
+                // removed it; stay in the critical section until it is gone
+                if (e.next[0].load() & erased)
+                {
+                    search(key, preds, succs);
+                    return;
+                }
+            }
+        }
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+        private:
+            friend concurrent_skip_list;
+            element *me;
+            explicit iterator(element *e) noexcept
+                : me(e)
+            {}
+        public:
+            iterator() noexcept
+                : me(nullptr)
+            {}
+            reference operator*() const noexcept
+            {
+                return static_cast<T&>(*me);
+            }
+            pointer operator->() const noexcept
+            {
+                return static_cast<T*>(me);
+            }
+            iterator& operator++() noexcept
+            {
+                me = skip_erased(ptr(me->next[0].load()));
+                return *this;
+            }
+            iterator operator++(int) noexcept
+            {
+                iterator copy = *this;
+                ++*this;
+                return copy;
+            }
+            bool operator==(iterator const& r) const noexcept
+            {
+                return me == r.me;
+            }
+            bool operator!=(iterator const& r) const noexcept
+            {
+                return me != r.me;
+            }
+        };
+
+        explicit concurrent_skip_list(KeyOf key_of = KeyOf(), Less less = Less())
+            : key_of(key_of)
+            , less(less)
+        {
+            head.height = MaxHeight;
+        }
+        concurrent_skip_list(concurrent_skip_list const&) = delete;
+        concurrent_skip_list& operator=(concurrent_skip_list const&) = delete;
+        // no other thread may use the list any more
+        ~concurrent_skip_list()
+        {
+            element *e = ptr(head.next[0].load(std::memory_order_relaxed));
+            while (e != nullptr)
+            {
+                element *next = ptr(e->next[0].load(std::memory_order_relaxed));
+                if ((e->next[0].load(std::memory_order_relaxed) & erased) == 0)
+                {
+                    for (unsigned l = 0; l != e->height; ++l)
+                        e->next[l].store(0, std::memory_order_relaxed);
+                    e->height = 0;
+                }
+                e = next;
+            }
+        }
+
+        std::size_t size() const noexcept
+        {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+        // false when an element with the same key is already there
+        bool insert(T &n, participant &p)
+        {
+            element &e = cast_el(n);
+            assert(e.height == 0);
+            auto const& key = key_of(n);
+            e.height = random_height();
+            epoch_domain::guard g(p);
+            element *preds[MaxHeight];
+            element *succs[MaxHeight];
+            for (;;)
+            {
+                if (search(key, preds, succs))
+                {
+                    e.height = 0;
+                    return false;
+                }
+                for (unsigned l = 0; l != e.height; ++l)
+                    e.next[l].store(word(succs[l]), std::memory_order_relaxed);
+                std::uintptr_t expected = word(succs[0]);
+                if (preds[0]->next[0].compare_exchange_strong(expected, word(&e)))
+                    break;
+            }
+            size_.fetch_add(1, std::memory_order_relaxed);
+            build_tower(e, key, preds, succs);
+            return true;
+        }
+
+        // false when no element has the key; the erased one goes to
+        // Reclaim once nobody can reach it
+        template <typename K>
+        bool erase(K const& key, participant &p)
+        {
+            epoch_domain::guard g(p);
+            element *preds[MaxHeight];
+            element *succs[MaxHeight];
+            if (!search(key, preds, succs))
+                return false;
+            element &victim = *succs[0];
+            for (unsigned l = victim.height; l-- > 1;)
+            {
+                std::uintptr_t w = victim.next[l].load();
+                while ((w & erased) == 0 && !victim.next[l].compare_exchange_weak(w, w | erased))
+                    ;
+            }
+            std::uintptr_t w = victim.next[0].load();
+            do
+            {
+                // somebody else got there first
+                if (w & erased)
+                    return false;
+            }
+            while (!victim.next[0].compare_exchange_weak(w, w | erased));
+            size_.fetch_sub(1, std::memory_order_relaxed);
+            search(key, preds, succs);
+            p.retire(victim, &reclaim_element);
+            return true;
+        }
+
+        template <typename K>
+        bool contains(K const& key, participant &p) const
+        {
+            epoch_domain::guard g(p);
+            element *e = seek(key);
+            return e != nullptr && !less(key, key_of(cast_t(*e)));
+        }
+
+        // The lookups below need the caller's participant in a critical
+        // section for as long as the result is used.
+
+        template <typename K>
+        T *find(K const& key, participant &p) const
+        {
+            assert(p.inside());
+            (void)p;
+            element *e = seek(key);
+            if (e == nullptr || less(key, key_of(cast_t(*e))))
+                return nullptr;
+            return const_cast<T*>(&cast_t(*e));
+        }
+
+        // first element whose key is not less than key
+        template <typename K>
+        iterator lower_bound(K const& key, participant &p)
+        {
+            assert(p.inside());
+            (void)p;
+            return iterator(seek(key));
+        }
+
+        iterator begin(participant &p) noexcept
+        {
+            assert(p.inside());
+            (void)p;
+            return iterator(skip_erased(ptr(head.next[0].load())));
+        }
+        iterator end() noexcept
+        {
+            return iterator();
+        }
+    };
+}
@@ -0,0 +1,305 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+#include "concurrent_skip_list.h"
+#include "test_utils.h"
+
+namespace
+{
+    struct entry : intrusive::skip_list_element<intrusive::default_tag, 8>
+    {
+        int key = 0;
+        std::atomic<bool> reclaimed{false};
+    };
+
+    using index_type = intrusive::concurrent_skip_list<entry, intrusive::default_tag, 8, intrusive::member_key,
+                                                       std::less<>, mark_reclaimed>;
+
+    std::vector<int> keys(index_type &s, intrusive::epoch_domain::participant &p)
+    {
+        intrusive::epoch_domain::guard g(p);
+        std::vector<int> res;
+        for (auto it = s.begin(p); it != s.end(); ++it)
+            res.push_back(it->key);
+        return res;
+    }
+}
+
+TEST(concurrent_skip_list_testing, empty)
+{
+    intrusive::epoch_domain d;
+    intrusive::epoch_domain::participant p(d);
+    index_type s;
+    EXPECT_EQ(0u, s.size());
+    EXPECT_FALSE(s.contains(3, p));
+    EXPECT_FALSE(s.erase(3, p));
+    intrusive::epoch_domain::guard g(p);
+    EXPECT_TRUE(s.begin(p) == s.end());
+    EXPECT_TRUE(s.lower_bound(0, p) == s.end());
+}
+
+TEST(concurrent_skip_list_testing, insert_find_erase)
+{
+    std::vector<entry> entries(100);
+    {
+        intrusive::epoch_domain d;
+        intrusive::epoch_domain::participant p(d);
+        index_type s;
+        // even keys 0..198 in a scrambled order
+        for (int i = 0; i != 100; ++i)
+        {
+            entries[i].key = (i * 37 % 100) * 2;
+            EXPECT_TRUE(s.insert(entries[i], p));
+        }
+        EXPECT_EQ(100u, s.size());
+        std::vector<int> expected;
+        for (int k = 0; k != 200; k += 2)
+            expected.push_back(k);
+        EXPECT_EQ(expected, keys(s, p));
+
+        entry dup;
+        dup.key = 10;
+        EXPECT_FALSE(s.insert(dup, p));
+
+        {
+            intrusive::epoch_domain::guard g(p);
+            ASSERT_NE(nullptr, s.find(42, p));
+            EXPECT_EQ(42, s.find(42, p)->key);
+            EXPECT_EQ(nullptr, s.find(43, p));
+            EXPECT_EQ(44, s.lower_bound(43, p)->key);
+            EXPECT_EQ(0, s.lower_bound(-5, p)->key);
+            EXPECT_TRUE(s.lower_bound(199, p) == s.end());
+        }
+
+        for (int k = 0; k != 200; k += 4)
+            EXPECT_TRUE(s.erase(k, p));
+        EXPECT_FALSE(s.erase(0, p));
+        EXPECT_FALSE(s.contains(40, p));
+        EXPECT_TRUE(s.contains(42, p));
+        EXPECT_EQ(50u, s.size());
+        {
+            intrusive::epoch_domain::guard g(p);
+            EXPECT_EQ(42, s.lower_bound(40, p)->key);
+        }
+        expected.clear();
+        for (int k = 2; k < 200; k += 4)
+            expected.push_back(k);
+        EXPECT_EQ(expected, keys(s, p));
+    }
+    for (auto &e : entries)
+        EXPECT_EQ(e.key % 4 == 0, e.reclaimed.load());
+}
+
+TEST(concurrent_skip_list_testing, matches_map)
+{
+    constexpr int range = 1000;
+    std::vector<entry> entries(range);
+    for (int k = 0; k != range; ++k)
+    {
+        entries[k].key = k;
+        entries[k].reclaimed.store(true);
+    }
+    intrusive::epoch_domain d;
+    intrusive::epoch_domain::participant p(d);
+    index_type s;
+    std::map<int, entry*> ref;
+    std::mt19937 rng(3);
+    for (int step = 0; step != 20000; ++step)
+    {
+        int k = static_cast<int>(rng() % range);
+        if (rng() % 2)
+        {
+            // only reinsert once the previous erase was reclaimed
+            if (ref.count(k) == 0 && entries[k].reclaimed.load())
+            {
+                entries[k].reclaimed.store(false);
+                ASSERT_TRUE(s.insert(entries[k], p));
+                ref[k] = &entries[k];
+            }
+            p.collect();
+        }
+        else
+        {
+            ASSERT_EQ(ref.erase(k) == 1, s.erase(k, p));
+        }
+        if (step % 500 == 0)
+        {
+            intrusive::epoch_domain::guard g(p);
+            auto it = s.begin(p);
+            for (auto &kv : ref)
+            {
+                ASSERT_TRUE(it != s.end());
+                ASSERT_EQ(kv.first, it->key);
+                ++it;
+            }
+            ASSERT_TRUE(it == s.end());
+            int q = static_cast<int>(rng() % range);
+            auto lb = ref.lower_bound(q);
+            auto slb = s.lower_bound(q, p);
+            if (lb == ref.end())
+                ASSERT_TRUE(slb == s.end());
+            else
+                ASSERT_EQ(lb->first, slb->key);
+        }
+    }
+    EXPECT_EQ(ref.size(), s.size());
+}
+
+TEST(concurrent_skip_list_testing, concurrent_index)
+{
+    // writers own the keys k with k % writers == t, a reader checks that
+    // iteration stays ordered and lower_bound lands on a key not below
+    // the one asked for
+    constexpr int writers = 3;
+    constexpr int range = 600;
+    std::vector<entry> entries(range);
+    for (int k = 0; k != range; ++k)
+    {
+        entries[k].key = k;
+        entries[k].reclaimed.store(true);
+    }
+    intrusive::epoch_domain d;
+    index_type s;
+    std::atomic<bool> stop{false};
+
+    std::thread reader([&] {
+        intrusive::epoch_domain::participant p(d);
+        std::mt19937 rng(99);
+        while (!stop.load())
+        {
+            intrusive::epoch_domain::guard g(p);
+            int last = -1;
+            for (auto it = s.begin(p); it != s.end(); ++it)
+            {
+                ASSERT_LT(last, it->key);
+                last = it->key;
+            }
+            int q = static_cast<int>(rng() % range);
+            auto lb = s.lower_bound(q, p);
+            ASSERT_TRUE(lb == s.end() || lb->key >= q);
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t != writers; ++t)
+        threads.emplace_back([&, t] {
+            intrusive::epoch_domain::participant p(d);
+            std::mt19937 rng(static_cast<unsigned>(t));
+            std::vector<bool> in(range, false);
+            for (int step = 0; step != 20000; ++step)
+            {
+                int k = t + writers * static_cast<int>(rng() % (range / writers));
+                if (rng() % 2)
+                {
+                    if (in[k] || !entries[k].reclaimed.load())
+                    {
+                        p.collect();
+                        continue;
+                    }
+                    entries[k].reclaimed.store(false);
+                    ASSERT_TRUE(s.insert(entries[k], p));
+                    in[k] = true;
+                }
+                else
+                {
+                    ASSERT_EQ(bool(in[k]), s.erase(k, p));
+                    in[k] = false;
+                }
+                ASSERT_EQ(bool(in[k]), s.contains(k, p));
+            }
+            for (int k = t; k < range; k += writers)
+                ASSERT_EQ(bool(in[k]), s.erase(k, p));
+        });
+    for (auto &t : threads)
+        t.join();
+    stop.store(true);
+    reader.join();
+
+    intrusive::epoch_domain::participant p(d);
+    EXPECT_EQ(0u, s.size());
+    EXPECT_TRUE(keys(s, p).empty());
+}
+
+TEST(concurrent_skip_list_testing, contended_keys)
+{
+    // every thread inserts elements of its own under the same few keys, so
+    // inserts of one key collide, erases race for the same element and a
+    // tower is often still being built when its element gets erased
+    constexpr int threads_count = 4;
+    constexpr int range = 4;
+    std::vector<entry> entries(threads_count * range);
+    for (int i = 0; i != threads_count * range; ++i)
+    {
+        entries[i].key = i % range;
+        entries[i].reclaimed.store(true);
+    }
+    std::atomic<std::size_t> inserted{0};
+    std::atomic<std::size_t> erased{0};
+    {
+        intrusive::epoch_domain d;
+        index_type s;
+        std::atomic<bool> stop{false};
+
+        std::thread reader([&] {
+            intrusive::epoch_domain::participant p(d);
+            while (!stop.load())
+            {
+                intrusive::epoch_domain::guard g(p);
+                int last = -1;
+                for (auto it = s.begin(p); it != s.end(); ++it)
+                {
+                    ASSERT_LT(last, it->key);
+                    last = it->key;
+                }
+            }
+        });
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t != threads_count; ++t)
+            threads.emplace_back([&, t] {
+                intrusive::epoch_domain::participant p(d);
+                std::mt19937 rng(static_cast<unsigned>(t + 7));
+                for (int step = 0; step != 30000; ++step)
+                {
+                    int k = static_cast<int>(rng() % range);
+                    if (rng() % 2)
+                    {
+                        // still on the list or not yet handed back
+                        entry &e = entries[t * range + k];
+                        if (!e.reclaimed.load())
+                        {
+                            p.collect();
+                            continue;
+                        }
+                        e.reclaimed.store(false);
+                        if (s.insert(e, p))
+                            inserted.fetch_add(1);
+                        else
+                            e.reclaimed.store(true);
+                    }
+                    else if (s.erase(k, p))
+                    {
+                        erased.fetch_add(1);
+                    }
+                }
+            });
+        for (auto &t : threads)
+            t.join();
+        stop.store(true);
+        reader.join();
+
+        intrusive::epoch_domain::participant p(d);
+        for (int k = 0; k != range; ++k)
+            if (s.erase(k, p))
+                erased.fetch_add(1);
+        EXPECT_EQ(0u, s.size());
+        EXPECT_TRUE(keys(s, p).empty());
+    }
+    EXPECT_LT(0u, inserted.load());
+    EXPECT_EQ(inserted.load(), erased.load());
+    for (auto &e : entries)
+        EXPECT_TRUE(e.reclaimed.load());
+}
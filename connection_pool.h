@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct pool_idle_tag;
+    struct pool_host_tag;
+    struct pool_expiry_tag;
+
+    class pool_host;
+    class connection_pool;
+
+    // Pooled connection, owned by the caller. The host hook keeps it on its
+    // host's list for its whole life in the pool; the idle and expiry hooks
+    // are linked only while it is checked in.
+    class pooled_connection
+        : public list_element<pool_idle_tag>
+        , public list_element<pool_host_tag>
+        , public list_element<pool_expiry_tag>
+    {
+    private:
+        friend class connection_pool;
+        pool_host *host_ = nullptr;
+        std::chrono::steady_clock::time_point last_used;
+    public:
+        pooled_connection() = default;
+        pooled_connection(pooled_connection const&) = delete;
+        pooled_connection& operator=(pooled_connection const&) = delete;
+        virtual ~pooled_connection() = default;
+
+        pool_host *host() const noexcept
+        {
+            return host_;
+        }
+        bool is_idle() const noexcept
+        {
+            return list_element<pool_idle_tag>::is_linked();
+        }
+    };
+
+    // Backend endpoint with its own connections. Idle ones form a stack so
+    // that checkout reuses the most recently used, still warm, connection.
+    class pool_host
+    {
+    private:
+        friend class connection_pool;
+        list<pooled_connection, pool_idle_tag> idle;
+        list<pooled_connection, pool_host_tag> members;
+        std::size_t idle_count = 0;
+        std::size_t total = 0;
+        std::size_t limit;
+    public:
+        explicit pool_host(std::size_t max_connections = 64) noexcept
+            : limit(max_connections)
+        {}
+        pool_host(pool_host const&) = delete;
+        pool_host& operator=(pool_host const&) = delete;
+
+        std::size_t idle_connections() const noexcept
+        {
+            return idle_count;
+        }
+        std::size_t connections() const noexcept
+        {
+            return total;
+        }
+        // whether a new connection may be opened
+        bool has_capacity() const noexcept
+        {
+            return total < limit;
+        }
+
+        template <typename F>
+        void for_each(F f)
+        {
+            for (auto it = members.begin(); it != members.end(); ++it)
+                f(*it);
+        }
+    };
+
+    // Connection pool for a single event loop, every operation is O(1) per
+    // connection touched. Checked in connections sit on one expiry list in
+    // order of last use, so the ones idle for too long are always at its front.
+    class connection_pool
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+    private:
+        list<pooled_connection, pool_expiry_tag> expiry;
+        clock::duration idle_timeout;
+
+        static void make_busy(pooled_connection &c) noexcept
+        {
+            c.list_element<pool_idle_tag>::unlink();
+            c.list_element<pool_expiry_tag>::unlink();
+            c.host_->idle_count--;
+        }
+    public:
+        explicit connection_pool(clock::duration idle_timeout) noexcept
+            : idle_timeout(idle_timeout)
+        {}
+        connection_pool(connection_pool const&) = delete;
+        connection_pool& operator=(connection_pool const&) = delete;
+
+        // most recently returned idle connection of h, nullptr if there is none
+        pooled_connection *checkout(pool_host &h) noexcept
+        {
+            if (h.idle.empty())
+                return nullptr;
+            pooled_connection &c = h.idle.front();
+            make_busy(c);
+            return &c;
+        }
+
+        // registers a freshly opened connection of h as checked out
+        void adopt(pool_host &h, pooled_connection &c) noexcept
+        {
+            assert(c.host_ == nullptr);
+            c.host_ = &h;
+            h.members.push_back(c);
+            h.total++;
+        }
+
+        void checkin(pooled_connection &c, clock::time_point now = clock::now()) noexcept
+        {
+            assert(c.host_ != nullptr && !c.is_idle());
+            assert(expiry.empty() || expiry.back().last_used <= now);
+            c.last_used = now;
+            c.host_->idle.push_front(c);
+            c.host_->idle_count++;
+            expiry.push_back(c);
+        }
+
+        // forgets c, idle or not, e.g. after an I/O error; the caller closes it
+        void discard(pooled_connection &c) noexcept
+        {
+            assert(c.host_ != nullptr);
+            if (c.is_idle())
+                make_busy(c);
+            c.list_element<pool_host_tag>::unlink();
+            c.host_->total--;
+            c.host_ = nullptr;
+        }
+
+        // Removes connections idle since before now - idle_timeout, oldest
+        // first, and passes each to on_expired, which may destroy it.
+        // Returns how many were removed.
+        template <typename F>
+        std::size_t expire(clock::time_point now, F on_expired)
+        {
+            std::size_t n = 0;
+            while (!expiry.empty() && expiry.front().last_used + idle_timeout <= now)
+            {
+                pooled_connection &c = expiry.front();
+                discard(c);
+                on_expired(c);
+                n++;
+            }
+            return n;
+        }
+
+        // when the oldest idle connection is due, for arming a timer
+        bool next_expiry(clock::time_point &at) const noexcept
+        {
+            if (expiry.empty())
+                return false;
+            at = expiry.front().last_used + idle_timeout;
+            return true;
+        }
+    };
+}
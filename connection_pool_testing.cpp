@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "connection_pool.h"
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using clock_type = intrusive::connection_pool::clock;
+
+    // a socketpair stands in for the backend, the far end echoes nothing and just records
+    struct socket_connection : intrusive::pooled_connection
+    {
+        socket_connection()
+        {
+            EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+        }
+        ~socket_connection() override
+        {
+            ::close(fds[0]);
+            ::close(fds[1]);
+        }
+
+        bool roundtrip(char c)
+        {
+            char got = 0;
+            return ::write(fds[0], &c, 1) == 1 && ::read(fds[1], &got, 1) == 1 && got == c;
+        }
+
+        int fds[2] = {-1, -1};
+    };
+
+    struct plain_connection : intrusive::pooled_connection
+    {
+        int id = 0;
+    };
+}
+
+TEST(connection_pool_testing, empty_host)
+{
+    intrusive::connection_pool pool(1s);
+    intrusive::pool_host h(2);
+    EXPECT_EQ(nullptr, pool.checkout(h));
+    EXPECT_TRUE(h.has_capacity());
+    clock_type::time_point at;
+    EXPECT_FALSE(pool.next_expiry(at));
+}
+
+TEST(connection_pool_testing, lifo_reuse)
+{
+    std::vector<plain_connection> conns(3);
+    intrusive::pool_host h(3);
+    intrusive::connection_pool pool(10s);
+    auto t = clock_type::now();
+    for (int i = 0; i != 3; ++i)
+    {
+        conns[i].id = i;
+        pool.adopt(h, conns[i]);
+        EXPECT_EQ(&h, conns[i].host());
+    }
+    EXPECT_FALSE(h.has_capacity());
+    for (int i = 0; i != 3; ++i)
+        pool.checkin(conns[i], t + std::chrono::milliseconds(i));
+    EXPECT_EQ(3u, h.idle_connections());
+
+    // the warmest one comes back first
+    auto *c = static_cast<plain_connection*>(pool.checkout(h));
+    ASSERT_NE(nullptr, c);
+    EXPECT_EQ(2, c->id);
+    EXPECT_FALSE(c->is_idle());
+    pool.checkin(*c, t + 5ms);
+    EXPECT_EQ(2, static_cast<plain_connection*>(pool.checkout(h))->id);
+    EXPECT_EQ(1, static_cast<plain_connection*>(pool.checkout(h))->id);
+    EXPECT_EQ(0, static_cast<plain_connection*>(pool.checkout(h))->id);
+    EXPECT_EQ(nullptr, pool.checkout(h));
+    EXPECT_EQ(0u, h.idle_connections());
+    EXPECT_EQ(3u, h.connections());
+}
+
+TEST(connection_pool_testing, expire_oldest_first)
+{
+    std::vector<plain_connection> conns(4);
+    intrusive::pool_host a, b;
+    intrusive::connection_pool pool(100ms);
+    auto t = clock_type::now();
+    for (int i = 0; i != 4; ++i)
+    {
+        conns[i].id = i;
+        pool.adopt(i % 2 ? b : a, conns[i]);
+        pool.checkin(conns[i], t + std::chrono::milliseconds(10 * i));
+    }
+    // a reused connection is no longer idle and cannot expire
+    ASSERT_EQ(&conns[3], pool.checkout(b));
+
+    clock_type::time_point at;
+    ASSERT_TRUE(pool.next_expiry(at));
+    EXPECT_EQ(t + 100ms, at);
+
+    std::vector<int> expired;
+    auto collect = [&](intrusive::pooled_connection &c) {
+        expired.push_back(static_cast<plain_connection&>(c).id);
+    };
+    EXPECT_EQ(0u, pool.expire(t + 99ms, collect));
+    EXPECT_EQ(2u, pool.expire(t + 110ms, collect));
+    EXPECT_EQ((std::vector<int>{0, 1}), expired);
+    EXPECT_EQ(nullptr, conns[0].host());
+    EXPECT_EQ(1u, a.connections());
+    EXPECT_EQ(1u, b.connections());
+
+    EXPECT_EQ(1u, pool.expire(t + 1s, collect));
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), expired);
+    EXPECT_FALSE(pool.next_expiry(at));
+    EXPECT_EQ(0u, a.connections());
+}
+
+TEST(connection_pool_testing, discard)
+{
+    std::vector<plain_connection> conns(2);
+    intrusive::pool_host h;
+    intrusive::connection_pool pool(1s);
+    auto t = clock_type::now();
+    pool.adopt(h, conns[0]);
+    pool.adopt(h, conns[1]);
+    pool.checkin(conns[0], t);
+
+    pool.discard(conns[0]);
+    pool.discard(conns[1]);
+    EXPECT_EQ(0u, h.connections());
+    EXPECT_EQ(0u, h.idle_connections());
+    EXPECT_EQ(nullptr, pool.checkout(h));
+    EXPECT_EQ(0u, pool.expire(t + 1h, [](intrusive::pooled_connection&) {}));
+}
+
+TEST(connection_pool_testing, socket_backend)
+{
+    intrusive::pool_host h(8);
+    intrusive::connection_pool pool(50ms);
+    std::vector<std::unique_ptr<socket_connection>> owned;
+
+    auto get = [&]() -> socket_connection& {
+        if (auto *c = pool.checkout(h))
+            return static_cast<socket_connection&>(*c);
+        owned.push_back(std::make_unique<socket_connection>());
+        pool.adopt(h, *owned.back());
+        return *owned.back();
+    };
+
+    // sequential requests reuse one connection
+    for (int i = 0; i != 100; ++i)
+    {
+        socket_connection &c = get();
+        EXPECT_TRUE(c.roundtrip(static_cast<char>(i)));
+        pool.checkin(c);
+    }
+    EXPECT_EQ(1u, owned.size());
+
+    // overlapping requests open more, up to the limit
+    std::vector<socket_connection*> busy;
+    while (h.has_capacity())
+        busy.push_back(&get());
+    EXPECT_EQ(8u, h.connections());
+    for (auto *c : busy)
+    {
+        EXPECT_TRUE(c->roundtrip('x'));
+        pool.checkin(*c);
+    }
+
+    std::size_t closed = pool.expire(clock_type::now() + 1s, [&](intrusive::pooled_connection &c) {
+        for (auto &o : owned)
+            if (o.get() == &c)
+                o.reset();
+    });
+    EXPECT_EQ(8u, closed);
+    EXPECT_EQ(0u, h.connections());
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct dag_ready_tag;
+    struct dag_member_tag;
+    struct dag_successor_tag;
+
+    class dag_task;
+    class dag_executor;
+
+    // Dependency arc, owned by the caller; links into the successor list of its source.
+    class dag_edge : public list_element<dag_successor_tag>
+    {
+    private:
+        friend class dag;
+        friend class dag_executor;
+        dag_task *target = nullptr;
+    };
+
+    // Unit of work. The ready hook puts it on a worker's run list once all
+    // predecessors have finished; run() must not throw.
+    class dag_task
+        : public list_element<dag_ready_tag>
+        , public list_element<dag_member_tag>
+    {
+    private:
+        friend class dag;
+        friend class dag_executor;
+        list<dag_edge, dag_successor_tag> successors;
+        std::size_t dependencies = 0;
+        std::atomic<std::size_t> pending{0};
+    public:
+        dag_task() = default;
+        dag_task(dag_task const&) = delete;
+        dag_task& operator=(dag_task const&) = delete;
+        virtual ~dag_task() = default;
+
+        virtual void run() = 0;
+    };
+
+    // Set of tasks with dependencies; must stay acyclic.
+    class dag
+    {
+    private:
+        friend class dag_executor;
+        list<dag_task, dag_member_tag> tasks;
+    public:
+        void add(dag_task &t) noexcept
+        {
+            tasks.push_back(t);
+        }
+
+        // after runs only once before has finished
+        static void precede(dag_edge &e, dag_task &before, dag_task &after) noexcept
+        {
+            e.target = &after;
+            before.successors.push_back(e);
+            after.dependencies++;
+        }
+    };
+
+    // Runs a dag on a fixed pool of workers, the calling thread included.
+    // Each worker owns a run list; finishing a task collects its successors
+    // that became ready into a local batch and splices the batch onto the
+    // worker's list under one lock. Idle workers steal half of a victim's list.
+    class dag_executor
+    {
+    private:
+        struct worker
+        {
+            std::mutex m;
+            list<dag_task, dag_ready_tag> queue;
+            std::size_t size = 0;
+        };
+
+        std::size_t count;
+        std::unique_ptr<worker[]> workers;
+        std::atomic<std::size_t> remaining{0};
+
+        std::mutex pool_mutex;
+        std::condition_variable start_cv;
+        std::condition_variable done_cv;
+        std::uint64_t generation = 0;
+        std::size_t busy = 0;
+        bool stopping = false;
+        std::vector<std::thread> threads;
+
+        dag_task *pop(std::size_t self) noexcept
+        {
+            worker &w = workers[self];
+            std::lock_guard<std::mutex> lg(w.m);
+            if (w.queue.empty())
+                return nullptr;
+            dag_task &t = w.queue.front();
+            w.queue.pop_front();
+            w.size--;
+            return &t;
+        }
+
+        dag_task *steal(std::size_t self) noexcept
+        {
+            for (std::size_t k = 1; k != count; ++k)
+            {
+                worker &victim = workers[(self + k) % count];
+                list<dag_task, dag_ready_tag> loot;
+                std::size_t taken;
+                {
+                    std::lock_guard<std::mutex> lg(victim.m);
+                    if (victim.size == 0)
+                        continue;
+                    taken = (victim.size + 1) / 2;
+                    auto first = victim.queue.end();
+                    for (std::size_t i = 0; i != taken; ++i)
+                        --first;
+                    loot.splice(loot.end(), victim.queue, first, victim.queue.end());
+                    victim.size -= taken;
+                }
+                dag_task &t = loot.front();
+                loot.pop_front();
+                if (taken > 1)
+                {
+                    worker &w = workers[self];
+                    std::lock_guard<std::mutex> lg(w.m);
+                    w.queue.splice(w.queue.end(), loot, loot.begin(), loot.end());
+                    w.size += taken - 1;
+                }
+                return &t;
+            }
+            return nullptr;
+        }
+
+        void work(std::size_t self) noexcept
+        {
+            list<dag_task, dag_ready_tag> batch;
+            while (remaining.load(std::memory_order_acquire) != 0)
+            {
+                dag_task *t = pop(self);
+                if (t == nullptr)
+                    t = steal(self);
+                if (t == nullptr)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                t->run();
+
+                std::size_t ready = 0;
+                for (auto it = t->successors.begin(); it != t->successors.end(); ++it)
+                    if (it->target->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    {
+                        batch.push_back(*it->target);
+                        ready++;
+                    }
+                if (ready != 0)
+                {
+                    worker &w = workers[self];
+                    std::lock_guard<std::mutex> lg(w.m);
+                    w.queue.splice(w.queue.begin(), batch, batch.begin(), batch.end());
+                    w.size += ready;
+                }
+                remaining.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        void thread_main(std::size_t self) noexcept
+        {
+            std::uint64_t seen = 0;
+            std::unique_lock<std::mutex> lk(pool_mutex);
+            for (;;)
+            {
+                start_cv.wait(lk, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                lk.unlock();
+                work(self);
+                lk.lock();
+                if (--busy == 0)
+                    done_cv.notify_all();
+            }
+        }
+    public:
+        // threads_count workers in total, the thread calling run() is one of them
+        explicit dag_executor(std::size_t threads_count = std::thread::hardware_concurrency())
+            : count(threads_count == 0 ? 1 : threads_count)
+            , workers(new worker[count])
+        {
+            for (std::size_t i = 1; i < count; ++i)
+                threads.emplace_back([this, i] { thread_main(i); });
+        }
+        dag_executor(dag_executor const&) = delete;
+        dag_executor& operator=(dag_executor const&) = delete;
+        ~dag_executor()
+        {
+            {
+                std::lock_guard<std::mutex> lg(pool_mutex);
+                stopping = true;
+            }
+            start_cv.notify_all();
+            for (auto &t : threads)
+                t.join();
+        }
+
+        // runs every task of g once, returns when all have finished
+        void run(dag &g)
+        {
+            std::size_t total = 0, next = 0;
+            for (auto it = g.tasks.begin(); it != g.tasks.end(); ++it)
+            {
+                it->pending.store(it->dependencies, std::memory_order_relaxed);
+                total++;
+            }
+            if (total == 0)
+                return;
+            for (auto it = g.tasks.begin(); it != g.tasks.end(); ++it)
+                if (it->dependencies == 0)
+                {
+                    worker &w = workers[next++ % count];
+                    w.queue.push_back(*it);
+                    w.size++;
+                }
+            remaining.store(total, std::memory_order_release);
+
+            {
+                std::lock_guard<std::mutex> lg(pool_mutex);
+                busy = count - 1;
+                generation++;
+            }
+            start_cv.notify_all();
+            work(0);
+            std::unique_lock<std::mutex> lk(pool_mutex);
+            done_cv.wait(lk, [&] { return busy == 0; });
+        }
+    };
+}
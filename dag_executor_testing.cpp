@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <vector>
+#include "dag_executor.h"
+
+namespace
+{
+    std::atomic<int> clock_counter{0};
+
+    struct stamp_task : intrusive::dag_task
+    {
+        void run() override
+        {
+            runs++;
+            finished = clock_counter.fetch_add(1) + 1;
+        }
+
+        int runs = 0;
+        int finished = 0;
+    };
+
+    struct dependency
+    {
+        int before;
+        int after;
+    };
+
+    void build(intrusive::dag &g, std::vector<stamp_task> &tasks, std::vector<intrusive::dag_edge> &edges,
+               std::vector<dependency> const& deps)
+    {
+        for (auto &t : tasks)
+            g.add(t);
+        for (std::size_t i = 0; i != deps.size(); ++i)
+            intrusive::dag::precede(edges[i], tasks[deps[i].before], tasks[deps[i].after]);
+    }
+
+    void check(std::vector<stamp_task> const& tasks, std::vector<dependency> const& deps, int runs)
+    {
+        for (auto &t : tasks)
+            EXPECT_EQ(runs, t.runs);
+        for (auto &d : deps)
+            EXPECT_LT(tasks[d.before].finished, tasks[d.after].finished);
+    }
+}
+
+TEST(dag_executor_testing, empty)
+{
+    intrusive::dag g;
+    intrusive::dag_executor ex(4);
+    ex.run(g);
+}
+
+TEST(dag_executor_testing, diamond)
+{
+    std::vector<dependency> deps = {{0, 1}, {0, 2}, {1, 3}, {2, 3}};
+    std::vector<intrusive::dag_edge> edges(deps.size());
+    std::vector<stamp_task> tasks(4);
+    intrusive::dag g;
+    build(g, tasks, edges, deps);
+
+    intrusive::dag_executor ex(3);
+    ex.run(g);
+    check(tasks, deps, 1);
+    ex.run(g);
+    check(tasks, deps, 2);
+}
+
+TEST(dag_executor_testing, single_thread)
+{
+    std::vector<dependency> deps;
+    for (int i = 0; i + 1 < 100; ++i)
+        deps.push_back({i, i + 1});
+    std::vector<intrusive::dag_edge> edges(deps.size());
+    std::vector<stamp_task> tasks(100);
+    intrusive::dag g;
+    build(g, tasks, edges, deps);
+
+    intrusive::dag_executor ex(1);
+    ex.run(g);
+    check(tasks, deps, 1);
+}
+
+TEST(dag_executor_testing, wide)
+{
+    // source -> 1000 tasks -> sink
+    constexpr int width = 1000;
+    std::vector<dependency> deps;
+    for (int i = 1; i <= width; ++i)
+    {
+        deps.push_back({0, i});
+        deps.push_back({i, width + 1});
+    }
+    std::vector<intrusive::dag_edge> edges(deps.size());
+    std::vector<stamp_task> tasks(width + 2);
+    intrusive::dag g;
+    build(g, tasks, edges, deps);
+
+    intrusive::dag_executor ex(4);
+    for (int r = 1; r <= 3; ++r)
+    {
+        ex.run(g);
+        check(tasks, deps, r);
+    }
+}
+
+TEST(dag_executor_testing, random)
+{
+    constexpr int n = 2000;
+    std::mt19937 rng(11);
+    std::vector<dependency> deps;
+    for (int i = 1; i != n; ++i)
+        for (int k = 0; k != 3; ++k)
+        {
+            int before = static_cast<int>(rng() % i);
+            deps.push_back({before, i});
+        }
+    std::vector<intrusive::dag_edge> edges(deps.size());
+    std::vector<stamp_task> tasks(n);
+    intrusive::dag g;
+    build(g, tasks, edges, deps);
+
+    intrusive::dag_executor ex(8);
+    ex.run(g);
+    check(tasks, deps, 1);
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <unistd.h>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct dirty_tag;
+
+    // Buffers small writes and hands them to the fd in large chunks.
+    class checkpoint_writer
+    {
+    private:
+        int fd;
+        std::unique_ptr<char[]> buffer;
+        std::size_t capacity;
+        std::size_t used = 0;
+        std::size_t written_ = 0;
+
+        void write_all(char const *data, std::size_t n)
+        {
+            while (n != 0)
+            {
+                ssize_t res = ::write(fd, data, n);
+                if (res < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::system_error(errno, std::system_category(), "write");
+                }
+                data += res;
+                n -= static_cast<std::size_t>(res);
+            }
+        }
+    public:
+        explicit checkpoint_writer(int fd, std::size_t buffer_bytes = 1 << 16)
+            : fd(fd)
+            , buffer(new char[buffer_bytes])
+            , capacity(buffer_bytes)
+        {
+            assert(buffer_bytes != 0);
+        }
+        checkpoint_writer(checkpoint_writer const&) = delete;
+        checkpoint_writer& operator=(checkpoint_writer const&) = delete;
+        // unflushed data is dropped, call flush() to see errors
+        ~checkpoint_writer() = default;
+
+        void write(void const *data, std::size_t n)
+        {
+            auto src = static_cast<char const*>(data);
+            if (used + n > capacity)
+            {
+                flush();
+                // too big to be worth copying
+                if (n >= capacity)
+                {
+                    write_all(src, n);
+                    written_ += n;
+                    return;
+                }
+            }
+            std::memcpy(buffer.get() + used, src, n);
+            used += n;
+            written_ += n;
+        }
+
+        template <typename V>
+        void write_value(V const& v)
+        {
+            static_assert(std::is_trivially_copyable_v<V>, "value must be trivially copyable");
+            write(&v, sizeof(V));
+        }
+
+        void flush()
+        {
+            write_all(buffer.get(), used);
+            used = 0;
+        }
+
+        // bytes accepted so far, flushed or not
+        std::size_t written() const noexcept
+        {
+            return written_;
+        }
+    };
+
+    // Object whose state goes into checkpoints. The hook is linked while the
+    // object is dirty, so marking it again before the next checkpoint is a no-op.
+    class checkpointable : public list_element<dirty_tag>
+    {
+    public:
+        checkpointable() = default;
+        checkpointable(checkpointable const&) = delete;
+        checkpointable& operator=(checkpointable const&) = delete;
+        virtual ~checkpointable()
+        {
+            list_element<dirty_tag>::unlink();
+        }
+
+        virtual void save(checkpoint_writer &out) const = 0;
+    };
+
+    // Remembers which objects changed since the last checkpoint so that only
+    // those are written. A destroyed object leaves the dirty set by itself.
+    // Not thread-safe.
+    class dirty_tracker
+    {
+    public:
+        using dirty_list = list<checkpointable, dirty_tag>;
+    private:
+        dirty_list dirty;
+    public:
+        dirty_tracker() = default;
+        dirty_tracker(dirty_tracker const&) = delete;
+        dirty_tracker& operator=(dirty_tracker const&) = delete;
+
+        // to be called on every modification, O(1)
+        void mark_dirty(checkpointable &obj) noexcept
+        {
+            if (!obj.is_linked())
+                dirty.push_back(obj);
+        }
+
+        bool empty() const noexcept
+        {
+            return dirty.empty();
+        }
+
+        // detaches the current dirty set in O(1); tracking starts over empty
+        dirty_list take() noexcept
+        {
+            return std::move(dirty);
+        }
+
+        // writes every dirty object to fd, returns bytes written.
+        // save() must not modify tracked objects. If writing fails,
+        // the whole set stays dirty.
+        std::size_t checkpoint(int fd, std::size_t buffer_bytes = 1 << 16)
+        {
+            checkpoint_writer out(fd, buffer_bytes);
+            dirty_list batch = take();
+            try
+            {
+                for (auto it = batch.begin(); it != batch.end(); ++it)
+                    it->save(out);
+                out.flush();
+            }
+            catch (...)
+            {
+                dirty.splice(dirty.begin(), batch, batch.begin(), batch.end());
+                throw;
+            }
+            return out.written();
+        }
+    };
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "dirty_tracker.h"
+#include "test_utils.h"
+
+namespace
+{
+    struct account : intrusive::checkpointable
+    {
+        void save(intrusive::checkpoint_writer &out) const override
+        {
+            out.write_value(id);
+            out.write_value(balance);
+        }
+
+        std::uint32_t id = 0;
+        std::int32_t balance = 0;
+    };
+
+    struct record
+    {
+        std::uint32_t id;
+        std::int32_t balance;
+    };
+
+    std::vector<record> parse(std::string const& s)
+    {
+        std::vector<record> res(s.size() / sizeof(record));
+        std::memcpy(res.data(), s.data(), res.size() * sizeof(record));
+        return res;
+    }
+
+    void deposit(intrusive::dirty_tracker &t, account &a, int amount)
+    {
+        a.balance += amount;
+        t.mark_dirty(a);
+    }
+
+    struct blob : intrusive::checkpointable
+    {
+        void save(intrusive::checkpoint_writer &out) const override
+        {
+            out.write(data.data(), data.size());
+        }
+
+        std::string data;
+    };
+}
+
+TEST(dirty_tracker_testing, empty)
+{
+    temp_file f;
+    intrusive::dirty_tracker t;
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(0u, t.checkpoint(f.fd()));
+    EXPECT_EQ("", f.contents());
+}
+
+TEST(dirty_tracker_testing, only_dirty_objects_are_written)
+{
+    temp_file f;
+    std::vector<account> accounts(10);
+    intrusive::dirty_tracker t;
+    for (std::uint32_t i = 0; i != accounts.size(); ++i)
+        accounts[i].id = i;
+
+    deposit(t, accounts[3], 10);
+    deposit(t, accounts[7], 5);
+    deposit(t, accounts[3], 1);
+    EXPECT_FALSE(t.empty());
+    EXPECT_EQ(2 * sizeof(record), t.checkpoint(f.fd()));
+    EXPECT_TRUE(t.empty());
+
+    auto recs = parse(f.contents());
+    ASSERT_EQ(2u, recs.size());
+    EXPECT_EQ(3u, recs[0].id);
+    EXPECT_EQ(11, recs[0].balance);
+    EXPECT_EQ(7u, recs[1].id);
+    EXPECT_EQ(5, recs[1].balance);
+
+    // the next epoch starts clean
+    f.reset();
+    deposit(t, accounts[7], 1);
+    t.checkpoint(f.fd());
+    recs = parse(f.contents());
+    ASSERT_EQ(1u, recs.size());
+    EXPECT_EQ(7u, recs[0].id);
+    EXPECT_EQ(6, recs[0].balance);
+}
+
+TEST(dirty_tracker_testing, take)
+{
+    std::vector<account> accounts(3);
+    intrusive::dirty_tracker t;
+    deposit(t, accounts[0], 1);
+    deposit(t, accounts[2], 1);
+
+    auto batch = t.take();
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(&accounts[0], &batch.front());
+    EXPECT_EQ(&accounts[2], &batch.back());
+    batch.clear();
+
+    deposit(t, accounts[0], 1);
+    EXPECT_FALSE(t.empty());
+}
+
+TEST(dirty_tracker_testing, destroyed_object_leaves)
+{
+    temp_file f;
+    intrusive::dirty_tracker t;
+    account keep;
+    keep.id = 1;
+    deposit(t, keep, 1);
+    {
+        account gone;
+        gone.id = 2;
+        deposit(t, gone, 1);
+    }
+    EXPECT_EQ(sizeof(record), t.checkpoint(f.fd()));
+    EXPECT_EQ(1u, parse(f.contents())[0].id);
+}
+
+TEST(dirty_tracker_testing, large_records)
+{
+    temp_file f;
+    intrusive::dirty_tracker t;
+    std::vector<blob> blobs(5);
+    std::string expected;
+    for (std::size_t i = 0; i != blobs.size(); ++i)
+    {
+        // both smaller and larger than the writer buffer
+        blobs[i].data.assign(i % 2 ? 100 : 5000, static_cast<char>('a' + i));
+        expected += blobs[i].data;
+        t.mark_dirty(blobs[i]);
+    }
+    EXPECT_EQ(expected.size(), t.checkpoint(f.fd(), 1024));
+    EXPECT_EQ(expected, f.contents());
+}
+
+TEST(dirty_tracker_testing, failed_write_keeps_objects_dirty)
+{
+    intrusive::dirty_tracker t;
+    account a;
+    deposit(t, a, 1);
+    int fds[2];
+    ASSERT_EQ(0, ::pipe(fds));
+    ::close(fds[1]);
+    EXPECT_THROW(t.checkpoint(fds[0]), std::system_error);
+    ::close(fds[0]);
+    EXPECT_FALSE(t.empty());
+}
+
+TEST(dirty_tracker_testing, random)
+{
+    temp_file f;
+    std::mt19937 rng(3);
+    std::vector<account> accounts(1000);
+    std::vector<std::int32_t> on_disk(accounts.size(), 0);
+    intrusive::dirty_tracker t;
+    for (std::uint32_t i = 0; i != accounts.size(); ++i)
+        accounts[i].id = i;
+
+    for (int epoch = 0; epoch != 20; ++epoch)
+    {
+        std::set<std::uint32_t> touched;
+        for (int k = 0; k != 100; ++k)
+        {
+            std::uint32_t i = rng() % accounts.size();
+            deposit(t, accounts[i], static_cast<int>(rng() % 100));
+            touched.insert(i);
+        }
+        f.reset();
+        t.checkpoint(f.fd(), 256);
+        auto recs = parse(f.contents());
+        ASSERT_EQ(touched.size(), recs.size());
+        for (auto &r : recs)
+        {
+            ASSERT_TRUE(touched.count(r.id));
+            on_disk[r.id] = r.balance;
+        }
+    }
+    for (std::uint32_t i = 0; i != accounts.size(); ++i)
+        EXPECT_EQ(accounts[i].balance, on_disk[i]);
+}
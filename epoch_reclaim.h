@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "intrusive_list.h"
+#include "spin_utils.h"
+
+namespace intrusive
+{
+    struct reclaim_tag;
+    struct participant_tag;
+
+    class epoch_domain;
+
+    // Base of anything unlinked from a lock-free structure while readers
+    // may still hold it. Once retired it waits on its participant's limbo
+    // list until no reader can reach it, then `reclaim` gets it back.
+    class reclaimable : public list_element<reclaim_tag>
+    {
+    private:
+        friend class epoch_domain;
+        std::uint64_t retired_epoch = 0;
+        void (*reclaim)(reclaimable&) = nullptr;
+    };
+
+    // default for containers built on an epoch_domain: leaves erased
+    // elements to their owner, who must know by other means that no reader
+    // holds them any more
+    struct no_reclaim
+    {
+        template <typename T>
+        void operator()(T&) const noexcept
+        {}
+    };
+
+    // default key of the ordered containers built on an epoch_domain: the
+    // element's public `key` member
+    struct member_key
+    {
+        template <typename T>
+        auto const& operator()(T const& e) const noexcept
+        {
+            return e.key;
+        }
+    };
+
+    // Epoch based reclamation after Fraser. Readers run inside critical
+    // sections that publish the global epoch they started in; the epoch
+    // moves on only when every thread inside a critical section has seen
+    // the current one. Something retired in epoch e is handed back once the
+    // global epoch reaches e + grace: two epochs cover readers that found it
+    // before it was unlinked, the third covers a stale pointer to it that a
+    // writer which found it earlier may publish and fix before it leaves,
+    // as the prev hints of lockfree_list do.
+    class epoch_domain
+    {
+    public:
+        static constexpr std::uint64_t grace = 3;
+
+        // per-thread state; critical sections nest, retire works anywhere
+        class participant : public list_element<participant_tag>
+        {
+        private:
+            friend class epoch_domain;
+            static constexpr std::size_t collect_every = 64;
+
+            epoch_domain &domain;
+            // epoch << 1 | inside a critical section
+            alignas(detail::cache_line_size) std::atomic<std::uint64_t> state{0};
+            unsigned depth = 0;
+            std::size_t since_collect = 0;
+            list<reclaimable, reclaim_tag> limbo;
+        public:
+            explicit participant(epoch_domain &d)
+                : domain(d)
+            {
+                std::lock_guard<std::mutex> lock(domain.m);
+                domain.participants.push_back(*this);
+            }
+            participant(participant const&) = delete;
+            participant& operator=(participant const&) = delete;
+            ~participant()
+            {
+                assert(depth == 0);
+                collect();
+                std::lock_guard<std::mutex> lock(domain.m);
+                list_element<participant_tag>::unlink();
+                domain.orphans.splice(domain.orphans.end(), limbo, limbo.begin(), limbo.end());
+            }
+
+            void enter() noexcept
+            {
+                if (depth++ != 0)
+                    return;
+                std::uint64_t e = domain.epoch.load();
+                for (;;)
+                {
+                    state.store(e << 1 | 1);
+                    // the epoch may have moved before the store became visible
+                    std::uint64_t now = domain.epoch.load();
+                    if (now == e)
+                        break;
+                    e = now;
+                }
+            }
+            void leave() noexcept
+            {
+                assert(depth != 0);
+                if (--depth == 0)
+                    state.store(state.load(std::memory_order_relaxed) & ~std::uint64_t(1),
+                                std::memory_order_release);
+            }
+            bool inside() const noexcept
+            {
+                return depth != 0;
+            }
+
+            // r must be unreachable for readers that start from now on
+            void retire(reclaimable &r, void (*reclaim)(reclaimable&)) noexcept
+            {
+                r.retired_epoch = domain.epoch.load();
+                r.reclaim = reclaim;
+                limbo.push_back(r);
+                if (++since_collect >= collect_every)
+                    collect();
+            }
+
+            // tries to advance the epoch, then hands back what is safe
+            void collect() noexcept
+            {
+                since_collect = 0;
+                domain.try_advance();
+                domain.reclaim_safe(limbo);
+            }
+        };
+
+        // critical section for the lifetime of the guard
+        class guard
+        {
+        private:
+            participant &p;
+        public:
+            explicit guard(participant &p) noexcept
+                : p(p)
+            {
+                p.enter();
+            }
+            guard(guard const&) = delete;
+            guard& operator=(guard const&) = delete;
+            ~guard()
+            {
+                p.leave();
+            }
+        };
+    private:
+        alignas(detail::cache_line_size) std::atomic<std::uint64_t> epoch{0};
+        std::mutex m;
+        list<participant, participant_tag> participants;
+        // left behind by participants that went away, guarded by m
+        list<reclaimable, reclaim_tag> orphans;
+
+        void try_advance() noexcept
+        {
+            std::lock_guard<std::mutex> lock(m);
+            std::uint64_t e = epoch.load();
+            for (auto it = participants.begin(); it != participants.end(); ++it)
+            {
+                std::uint64_t s = it->state.load();
+                if ((s & 1) && (s >> 1) != e)
+                    return;
+            }
+            epoch.store(e + 1);
+            reclaim_safe(orphans);
+        }
+
+        void reclaim_safe(list<reclaimable, reclaim_tag> &l) noexcept
+        {
+            std::uint64_t e = epoch.load();
+            // orphans from several participants interleave, scan it all
+            for (auto it = l.begin(); it != l.end();)
+            {
+                reclaimable &r = *it++;
+                if (r.retired_epoch + grace <= e)
+                {
+                    r.list_element<reclaim_tag>::unlink();
+                    r.reclaim(r);
+                }
+            }
+        }
+    public:
+        epoch_domain() = default;
+        epoch_domain(epoch_domain const&) = delete;
+        epoch_domain& operator=(epoch_domain const&) = delete;
+        ~epoch_domain()
+        {
+            assert(participants.empty());
+            while (!orphans.empty())
+            {
+                reclaimable &r = orphans.front();
+                orphans.pop_front();
+                r.reclaim(r);
+            }
+        }
+
+        std::uint64_t current_epoch() const noexcept
+        {
+            return epoch.load(std::memory_order_relaxed);
+        }
+    };
+}
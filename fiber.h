@@ -0,0 +1,473 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ucontext.h>
+
+#if defined(__SANITIZE_THREAD__)
+#include <sanitizer/tsan_interface.h>
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct fiber_run_tag;
+    struct fiber_sleep_tag;
+    struct fiber_join_tag;
+
+    class fiber_scheduler;
+
+    namespace detail
+    {
+        // ThreadSanitizer has to be told about stack switches it cannot see
+#if defined(__SANITIZE_THREAD__)
+        inline void *tsan_current_fiber() noexcept
+        {
+            return __tsan_get_current_fiber();
+        }
+        inline void *tsan_create_fiber() noexcept
+        {
+            return __tsan_create_fiber(0);
+        }
+        inline void tsan_destroy_fiber(void *f) noexcept
+        {
+            __tsan_destroy_fiber(f);
+        }
+        inline void tsan_switch_to_fiber(void *f) noexcept
+        {
+            __tsan_switch_to_fiber(f, 0);
+        }
+#else
+        inline void *tsan_current_fiber() noexcept
+        {
+            return nullptr;
+        }
+        inline void *tsan_create_fiber() noexcept
+        {
+            return nullptr;
+        }
+        inline void tsan_destroy_fiber(void *) noexcept
+        {}
+        inline void tsan_switch_to_fiber(void *) noexcept
+        {}
+#endif
+
+        // AddressSanitizer has to know which stack is in use: start before
+        // leaving a stack, a null fake_stack when leaving it for good, and
+        // finish first thing on the stack switched to
+#if defined(__SANITIZE_ADDRESS__)
+        inline void asan_start_switch(void **fake_stack, void const *bottom, std::size_t size) noexcept
+        {
+            __sanitizer_start_switch_fiber(fake_stack, bottom, size);
+        }
+        inline void asan_finish_switch(void *fake_stack, void const **bottom_old, std::size_t *size_old) noexcept
+        {
+            __sanitizer_finish_switch_fiber(fake_stack, bottom_old, size_old);
+        }
+#else
+        inline void asan_start_switch(void **, void const *, std::size_t) noexcept
+        {}
+        inline void asan_finish_switch(void *, void const **, std::size_t *) noexcept
+        {}
+#endif
+    }
+
+    // Fiber control block, owned by the caller. The run hook links it into a
+    // worker's run queue, the sleep hook into that worker's timer list and the
+    // join hook into the waiters of a fiber it joins; a fiber is on at most
+    // one of them at a time. run() must not throw.
+    class fiber
+        : public list_element<fiber_run_tag>
+        , public list_element<fiber_sleep_tag>
+        , public list_element<fiber_join_tag>
+    {
+    private:
+        friend class fiber_scheduler;
+        std::size_t stack_size;
+        std::unique_ptr<char[]> stack;
+        ucontext_t context;
+        void *tsan_fiber = nullptr;
+        std::chrono::steady_clock::time_point wake_at;
+
+        std::mutex join_mutex;
+        list<fiber, fiber_join_tag> joiners;
+        bool exited = false;
+        std::atomic<bool> done{false};
+        bool started = false;
+    public:
+        explicit fiber(std::size_t stack_size = 64 * 1024)
+            : stack_size(stack_size)
+        {}
+        fiber(fiber const&) = delete;
+        fiber& operator=(fiber const&) = delete;
+        virtual ~fiber() = default;
+
+        virtual void run() = 0;
+
+        bool finished() const noexcept
+        {
+            return done.load(std::memory_order_acquire);
+        }
+    };
+
+    // M:N fiber runtime on ucontext. Each worker owns a run queue and a list
+    // of sleeping fibers ordered by deadline. A fiber that stops running
+    // records what should happen to it and switches back to its worker, which
+    // requeues, parks or retires it only after its context has been saved, so
+    // another worker can never resume a half-switched fiber. Idle workers
+    // steal half of a victim's queue with one splice. The thread calling run()
+    // is worker 0.
+    class fiber_scheduler
+    {
+    private:
+        enum class action
+        {
+            yield,
+            sleep,
+            join,
+            exit,
+        };
+
+        struct worker
+        {
+            fiber_scheduler *owner = nullptr;
+            std::mutex m;
+            list<fiber, fiber_run_tag> queue;
+            std::size_t size = 0;
+
+            // touched by the worker's thread only
+            list<fiber, fiber_sleep_tag> sleeping;
+            ucontext_t context;
+            void *tsan_fiber = nullptr;
+            // the thread's own stack, learnt by the first fiber it runs
+            void const *asan_stack = nullptr;
+            std::size_t asan_stack_size = 0;
+            fiber *current = nullptr;
+            action next = action::yield;
+            fiber *join_target = nullptr;
+        };
+
+        std::size_t count;
+        std::unique_ptr<worker[]> workers;
+        std::atomic<std::size_t> live{0};
+        std::atomic<std::size_t> next_worker{0};
+
+        std::mutex pool_mutex;
+        std::condition_variable start_cv;
+        std::condition_variable done_cv;
+        std::uint64_t generation = 0;
+        std::size_t busy = 0;
+        bool stopping = false;
+        std::vector<std::thread> threads;
+
+        // A fiber may resume on another thread and must not reuse a
+        // thread-local address computed before the switch. noinline alone
+        // lets the compiler treat the call as const and reuse its result,
+        // the empty asm makes every call read the thread-local slot anew.
+        [[gnu::noinline]] static worker *&current_worker() noexcept
+        {
+            static thread_local worker *w = nullptr;
+            worker **p = &w;
+            asm volatile("" : "+r"(p));
+            return *p;
+        }
+
+        static void entry() noexcept
+        {
+            worker *w = current_worker();
+            detail::asan_finish_switch(nullptr, &w->asan_stack, &w->asan_stack_size);
+            w->current->run();
+            w = current_worker();
+            w->next = action::exit;
+            detail::tsan_switch_to_fiber(w->tsan_fiber);
+            detail::asan_start_switch(nullptr, w->asan_stack, w->asan_stack_size);
+            ::swapcontext(&w->current->context, &w->context);
+            assert(false);
+        }
+
+        // switches from the running fiber back to its worker
+        static void suspend(action a, fiber *target = nullptr) noexcept
+        {
+            worker *w = current_worker();
+            assert(w != nullptr && w->current != nullptr);
+            w->next = a;
+            w->join_target = target;
+            detail::tsan_switch_to_fiber(w->tsan_fiber);
+            void *fake_stack = nullptr;
+            detail::asan_start_switch(&fake_stack, w->asan_stack, w->asan_stack_size);
+            ::swapcontext(&w->current->context, &w->context);
+            // possibly on another worker now
+            w = current_worker();
+            detail::asan_finish_switch(fake_stack, &w->asan_stack, &w->asan_stack_size);
+        }
+
+        void push(worker &w, fiber &f) noexcept
+        {
+            std::lock_guard<std::mutex> lg(w.m);
+            w.queue.push_back(f);
+            w.size++;
+        }
+
+        void push_batch(worker &w, list<fiber, fiber_run_tag> &batch, std::size_t n) noexcept
+        {
+            if (n == 0)
+                return;
+            std::lock_guard<std::mutex> lg(w.m);
+            w.queue.splice(w.queue.end(), batch, batch.begin(), batch.end());
+            w.size += n;
+        }
+
+        fiber *pop(worker &w) noexcept
+        {
+            std::lock_guard<std::mutex> lg(w.m);
+            if (w.queue.empty())
+                return nullptr;
+            fiber &f = w.queue.front();
+            w.queue.pop_front();
+            w.size--;
+            return &f;
+        }
+
+        fiber *steal(std::size_t self) noexcept
+        {
+            for (std::size_t k = 1; k != count; ++k)
+            {
+                worker &victim = workers[(self + k) % count];
+                list<fiber, fiber_run_tag> loot;
+                std::size_t taken;
+                {
+                    std::lock_guard<std::mutex> lg(victim.m);
+                    if (victim.size == 0)
+                        continue;
+                    taken = (victim.size + 1) / 2;
+                    auto first = victim.queue.end();
+                    for (std::size_t i = 0; i != taken; ++i)
+                        --first;
+                    loot.splice(loot.end(), victim.queue, first, victim.queue.end());
+                    victim.size -= taken;
+                }
+                fiber &f = loot.front();
+                loot.pop_front();
+                push_batch(workers[self], loot, taken - 1);
+                return &f;
+            }
+            return nullptr;
+        }
+
+        void wake_sleepers(worker &w) noexcept
+        {
+            if (w.sleeping.empty())
+                return;
+            auto now = std::chrono::steady_clock::now();
+            list<fiber, fiber_run_tag> batch;
+            std::size_t n = 0;
+            while (!w.sleeping.empty() && w.sleeping.front().wake_at <= now)
+            {
+                fiber &f = w.sleeping.front();
+                w.sleeping.pop_front();
+                batch.push_back(f);
+                n++;
+            }
+            push_batch(w, batch, n);
+        }
+
+        // the fiber's context is saved by now, carry out what it asked for
+        void after_switch(worker &w, fiber &f) noexcept
+        {
+            switch (w.next)
+            {
+            case action::yield:
+                push(w, f);
+                break;
+            case action::sleep:
+            {
+                auto pos = w.sleeping.end();
+                while (pos != w.sleeping.begin() && std::prev(pos)->wake_at > f.wake_at)
+                    --pos;
+                w.sleeping.insert(pos, f);
+                break;
+            }
+            case action::join:
+            {
+                fiber &target = *w.join_target;
+                std::unique_lock<std::mutex> lk(target.join_mutex);
+                if (target.exited)
+                {
+                    lk.unlock();
+                    push(w, f);
+                }
+                else
+                {
+                    target.joiners.push_back(f);
+                }
+                break;
+            }
+            case action::exit:
+            {
+                list<fiber, fiber_run_tag> batch;
+                std::size_t n = 0;
+                {
+                    std::lock_guard<std::mutex> lg(f.join_mutex);
+                    f.exited = true;
+                    while (!f.joiners.empty())
+                    {
+                        fiber &j = f.joiners.front();
+                        f.joiners.pop_front();
+                        batch.push_back(j);
+                        n++;
+                    }
+                }
+                push_batch(w, batch, n);
+                f.stack.reset();
+                detail::tsan_destroy_fiber(f.tsan_fiber);
+                f.tsan_fiber = nullptr;
+                f.done.store(true, std::memory_order_release);
+                // f may be destroyed by its owner from here on
+                live.fetch_sub(1, std::memory_order_acq_rel);
+                break;
+            }
+            }
+        }
+
+        void work(std::size_t self) noexcept
+        {
+            worker &w = workers[self];
+            current_worker() = &w;
+            w.tsan_fiber = detail::tsan_current_fiber();
+            while (live.load(std::memory_order_acquire) != 0)
+            {
+                wake_sleepers(w);
+                fiber *f = pop(w);
+                if (f == nullptr)
+                    f = steal(self);
+                if (f == nullptr)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                w.current = f;
+                detail::tsan_switch_to_fiber(f->tsan_fiber);
+                void *fake_stack = nullptr;
+                detail::asan_start_switch(&fake_stack, f->stack.get(), f->stack_size);
+                ::swapcontext(&w.context, &f->context);
+                detail::asan_finish_switch(fake_stack, nullptr, nullptr);
+                w.current = nullptr;
+                after_switch(w, *f);
+            }
+            current_worker() = nullptr;
+        }
+
+        void thread_main(std::size_t self) noexcept
+        {
+            std::uint64_t seen = 0;
+            std::unique_lock<std::mutex> lk(pool_mutex);
+            for (;;)
+            {
+                start_cv.wait(lk, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                lk.unlock();
+                work(self);
+                lk.lock();
+                if (--busy == 0)
+                    done_cv.notify_all();
+            }
+        }
+    public:
+        // threads_count workers in total, the thread calling run() is one of them
+        explicit fiber_scheduler(std::size_t threads_count = std::thread::hardware_concurrency())
+            : count(threads_count == 0 ? 1 : threads_count)
+            , workers(new worker[count])
+        {
+            for (std::size_t i = 0; i != count; ++i)
+                workers[i].owner = this;
+            for (std::size_t i = 1; i < count; ++i)
+                threads.emplace_back([this, i] { thread_main(i); });
+        }
+        fiber_scheduler(fiber_scheduler const&) = delete;
+        fiber_scheduler& operator=(fiber_scheduler const&) = delete;
+        ~fiber_scheduler()
+        {
+            assert(live.load() == 0);
+            {
+                std::lock_guard<std::mutex> lg(pool_mutex);
+                stopping = true;
+            }
+            start_cv.notify_all();
+            for (auto &t : threads)
+                t.join();
+        }
+
+        // queues f to run; works from any thread, fibers included
+        void start(fiber &f)
+        {
+            assert(!f.started);
+            f.started = true;
+            f.stack.reset(new char[f.stack_size]);
+            ::getcontext(&f.context);
+            f.context.uc_stack.ss_sp = f.stack.get();
+            f.context.uc_stack.ss_size = f.stack_size;
+            f.context.uc_link = nullptr;
+            ::makecontext(&f.context, &fiber_scheduler::entry, 0);
+            f.tsan_fiber = detail::tsan_create_fiber();
+
+            live.fetch_add(1, std::memory_order_relaxed);
+            worker *w = current_worker();
+            if (w == nullptr || w->owner != this)
+                w = &workers[next_worker.fetch_add(1, std::memory_order_relaxed) % count];
+            push(*w, f);
+        }
+
+        // runs until every started fiber has finished
+        void run()
+        {
+            if (live.load(std::memory_order_acquire) == 0)
+                return;
+            {
+                std::lock_guard<std::mutex> lg(pool_mutex);
+                busy = count - 1;
+                generation++;
+            }
+            start_cv.notify_all();
+            work(0);
+            std::unique_lock<std::mutex> lk(pool_mutex);
+            done_cv.wait(lk, [&] { return busy == 0; });
+        }
+
+        // the calls below are only valid inside a running fiber
+
+        static void yield() noexcept
+        {
+            suspend(action::yield);
+        }
+
+        template <typename Rep, typename Period>
+        static void sleep_for(std::chrono::duration<Rep, Period> d) noexcept
+        {
+            current_worker()->current->wake_at
+                = std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(d);
+            suspend(action::sleep);
+        }
+
+        // waits until f has returned from run()
+        static void join(fiber &f) noexcept
+        {
+            assert(&f != current_worker()->current);
+            suspend(action::join, &f);
+        }
+    };
+}
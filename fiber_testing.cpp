@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "fiber.h"
+
+namespace
+{
+    using intrusive::fiber_scheduler;
+
+    struct counting_fiber : intrusive::fiber
+    {
+        void run() override
+        {
+            for (int i = 0; i != yields; ++i)
+            {
+                steps++;
+                fiber_scheduler::yield();
+            }
+            steps++;
+        }
+
+        int yields = 0;
+        int steps = 0;
+    };
+
+    // records the order in which fibers pass a point, under a lock
+    struct journal
+    {
+        void add(int v)
+        {
+            std::lock_guard<std::mutex> lg(m);
+            entries.push_back(v);
+        }
+
+        std::mutex m;
+        std::vector<int> entries;
+    };
+
+    struct ping_pong : intrusive::fiber
+    {
+        ping_pong(std::atomic<int> &ball, int parity, int rounds)
+            : fiber(16 * 1024)
+            , ball(ball)
+            , parity(parity)
+            , rounds(rounds)
+        {}
+
+        void run() override
+        {
+            for (int i = 0; i != rounds; ++i)
+            {
+                while (ball.load(std::memory_order_acquire) % 2 != parity)
+                    fiber_scheduler::yield();
+                ball.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        std::atomic<int> &ball;
+        int parity;
+        int rounds;
+    };
+}
+
+TEST(fiber_testing, empty)
+{
+    fiber_scheduler s(2);
+    s.run();
+}
+
+TEST(fiber_testing, yield_interleaves)
+{
+    counting_fiber a, b;
+    a.yields = b.yields = 10;
+    fiber_scheduler s(1);
+    s.start(a);
+    s.start(b);
+    EXPECT_FALSE(a.finished());
+    s.run();
+    EXPECT_TRUE(a.finished());
+    EXPECT_TRUE(b.finished());
+    EXPECT_EQ(11, a.steps);
+    EXPECT_EQ(11, b.steps);
+}
+
+TEST(fiber_testing, round_robin_on_one_worker)
+{
+    struct logger : intrusive::fiber
+    {
+        void run() override
+        {
+            for (int i = 0; i != 3; ++i)
+            {
+                log->add(id);
+                fiber_scheduler::yield();
+            }
+        }
+
+        journal *log = nullptr;
+        int id = 0;
+    };
+
+    journal j;
+    logger f[3];
+    fiber_scheduler s(1);
+    for (int i = 0; i != 3; ++i)
+    {
+        f[i].log = &j;
+        f[i].id = i;
+        s.start(f[i]);
+    }
+    s.run();
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 0, 1, 2, 0, 1, 2}), j.entries);
+}
+
+TEST(fiber_testing, join)
+{
+    struct child : intrusive::fiber
+    {
+        void run() override
+        {
+            for (int i = 0; i != 5; ++i)
+                fiber_scheduler::yield();
+            log->add(1);
+        }
+
+        journal *log = nullptr;
+    };
+
+    struct parent : intrusive::fiber
+    {
+        void run() override
+        {
+            sched->start(kid);
+            fiber_scheduler::join(kid);
+            log->add(2);
+            // joining a finished fiber returns right away
+            fiber_scheduler::join(kid);
+            log->add(3);
+        }
+
+        fiber_scheduler *sched = nullptr;
+        journal *log = nullptr;
+        child kid;
+    };
+
+    journal j;
+    auto p = std::make_unique<parent>();
+    fiber_scheduler s(2);
+    p->sched = &s;
+    p->log = &j;
+    p->kid.log = &j;
+    s.start(*p);
+    s.run();
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), j.entries);
+}
+
+TEST(fiber_testing, sleep_order)
+{
+    struct sleeper : intrusive::fiber
+    {
+        void run() override
+        {
+            fiber_scheduler::sleep_for(std::chrono::milliseconds(delay));
+            log->add(delay);
+        }
+
+        journal *log = nullptr;
+        int delay = 0;
+    };
+
+    journal j;
+    sleeper f[4];
+    int delays[4] = {40, 10, 30, 20};
+    fiber_scheduler s(1);
+    for (int i = 0; i != 4; ++i)
+    {
+        f[i].log = &j;
+        f[i].delay = delays[i];
+        s.start(f[i]);
+    }
+    auto before = std::chrono::steady_clock::now();
+    s.run();
+    EXPECT_GE(std::chrono::steady_clock::now() - before, std::chrono::milliseconds(40));
+    EXPECT_EQ((std::vector<int>{10, 20, 30, 40}), j.entries);
+}
+
+TEST(fiber_testing, sleep_fractional)
+{
+    struct sleeper : intrusive::fiber
+    {
+        void run() override
+        {
+            fiber_scheduler::sleep_for(std::chrono::duration<double, std::milli>(2.5));
+            done = true;
+        }
+
+        bool done = false;
+    };
+
+    sleeper f;
+    fiber_scheduler s(1);
+    s.start(f);
+    auto before = std::chrono::steady_clock::now();
+    s.run();
+    EXPECT_GE(std::chrono::steady_clock::now() - before, std::chrono::microseconds(2500));
+    EXPECT_TRUE(f.done);
+}
+
+TEST(fiber_testing, many_workers)
+{
+    std::vector<std::unique_ptr<counting_fiber>> fibers;
+    fiber_scheduler s(4);
+    for (int i = 0; i != 200; ++i)
+    {
+        fibers.push_back(std::make_unique<counting_fiber>());
+        fibers.back()->yields = i % 17;
+        s.start(*fibers.back());
+    }
+    s.run();
+    for (int i = 0; i != 200; ++i)
+        EXPECT_EQ(i % 17 + 1, fibers[i]->steps);
+
+    // the scheduler can be reused
+    counting_fiber last;
+    last.yields = 3;
+    s.start(last);
+    s.run();
+    EXPECT_EQ(4, last.steps);
+}
+
+TEST(fiber_testing, ping_pong)
+{
+    constexpr int pairs = 500;
+    constexpr int rounds = 20;
+    std::vector<std::atomic<int>> balls(pairs);
+    std::vector<std::unique_ptr<ping_pong>> fibers;
+    fiber_scheduler s(2);
+    for (int i = 0; i != pairs; ++i)
+        for (int parity = 0; parity != 2; ++parity)
+        {
+            fibers.push_back(std::make_unique<ping_pong>(balls[i], parity, rounds));
+            s.start(*fibers.back());
+        }
+    s.run();
+    for (auto &b : balls)
+        EXPECT_EQ(2 * rounds, b.load());
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+#include "intrusive_list.h"
+#include "spin_utils.h"
+
+namespace intrusive
+{
+    template <typename T, typename Tag>
+    class fine_locked_list;
+
+    // Hook for fine_locked_list with a one byte spinlock of its own. The
+    // lock guards next and prev of this element; prev changes only while
+    // both the element and its predecessor are locked.
+    template <typename Tag = default_tag>
+    class fine_locked_list_element
+    {
+    private:
+        template <typename FT, typename FTag>
+        friend class fine_locked_list;
+        detail::byte_spinlock spin;
+        fine_locked_list_element *next = nullptr;
+        fine_locked_list_element *prev = nullptr;
+    public:
+        fine_locked_list_element() = default;
+        fine_locked_list_element(fine_locked_list_element const&) = delete;
+        fine_locked_list_element& operator=(fine_locked_list_element const&) = delete;
+
+        // only meaningful while nobody edits the list around the element
+        bool is_linked() const noexcept
+        {
+            return next != nullptr;
+        }
+    };
+
+    // Doubly linked list where an edit locks only the elements whose links
+    // it changes, so edits at different places run in parallel. Waiting
+    // for a lock happens only from left to right: a walk couples locks hand
+    // over hand, insert_after locks pos then its successor, and the
+    // predecessor of an element, which lies to the left, is only tried;
+    // on failure everything is released and taken again, so the list
+    // cannot deadlock. Elements must stay alive while another thread may
+    // still pass them to the list, even after they were erased.
+    template <typename T, typename Tag = default_tag>
+    class fine_locked_list
+    {
+    private:
+        using element = fine_locked_list_element<Tag>;
+
+        element head;
+        element tail;
+        std::atomic<std::size_t> size_{0};
+
+        static element &cast_el(T &r) noexcept
+        {
+            return static_cast<element&>(r);
+        }
+        static T &cast_t(element &e) noexcept
+        {
+            return static_cast<T&>(e);
+        }
+
+        // locks x and then its predecessor; false, with nothing held, when
+        // x is not on the list
+        static bool lock_with_pred(element &x, element *&pred) noexcept
+        {
+            detail::spin_wait w;
+            for (;;)
+            {
+                x.spin.lock();
+                // prev rather than next, the tail has a predecessor only
+                if (x.prev == nullptr)
+                {
+                    x.spin.unlock();
+                    return false;
+                }
+                // the predecessor cannot leave while x is locked, but it
+                // may be waiting for x itself
+                if (x.prev->spin.try_lock())
+                {
+                    pred = x.prev;
+                    return true;
+                }
+                x.spin.unlock();
+                w.once();
+            }
+        }
+
+        // both neighbours locked
+        void link(element &pred, element &n, element &succ) noexcept
+        {
+            assert(n.next == nullptr);
+            n.prev = &pred;
+            n.next = &succ;
+            pred.next = &n;
+            succ.prev = &n;
+            size_.fetch_add(1, std::memory_order_relaxed);
+        }
+        // x and both neighbours locked
+        void unlink(element &x) noexcept
+        {
+            x.prev->next = x.next;
+            x.next->prev = x.prev;
+            x.next = x.prev = nullptr;
+            size_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool link_after(element &pos, element &n) noexcept
+        {
+            pos.spin.lock();
+            if (pos.next == nullptr)
+            {
+                pos.spin.unlock();
+                return false;
+            }
+            element &succ = *pos.next;
+            succ.spin.lock();
+            link(pos, n, succ);
+            succ.spin.unlock();
+            pos.spin.unlock();
+            return true;
+        }
+
+        bool link_before(element &pos, element &n) noexcept
+        {
+            element *pred;
+            if (!lock_with_pred(pos, pred))
+                return false;
+            link(*pred, n, pos);
+            pos.spin.unlock();
+            pred->spin.unlock();
+            return true;
+        }
+    public:
+        fine_locked_list() noexcept
+        {
+            head.next = &tail;
+            tail.prev = &head;
+        }
+        fine_locked_list(fine_locked_list const&) = delete;
+        fine_locked_list& operator=(fine_locked_list const&) = delete;
+        // no other thread may use the list any more
+        ~fine_locked_list()
+        {
+            element *e = head.next;
+            while (e != &tail)
+            {
+                element *next = e->next;
+                e->next = e->prev = nullptr;
+                e = next;
+            }
+        }
+
+        std::size_t size() const noexcept
+        {
+            return size_.load(std::memory_order_relaxed);
+        }
+        bool empty() const noexcept
+        {
+            return size() == 0;
+        }
+
+        void push_front(T &n) noexcept
+        {
+            link_after(head, cast_el(n));
+        }
+        void push_back(T &n) noexcept
+        {
+            link_before(tail, cast_el(n));
+        }
+
+        // false when pos is not on the list, n stays unlinked then
+        bool insert_after(T &pos, T &n) noexcept
+        {
+            return link_after(cast_el(pos), cast_el(n));
+        }
+        bool insert_before(T &pos, T &n) noexcept
+        {
+            return link_before(cast_el(pos), cast_el(n));
+        }
+
+        // false when x was not on the list, e.g. erased by somebody else
+        bool erase(T &x) noexcept
+        {
+            element &e = cast_el(x);
+            element *pred;
+            if (!lock_with_pred(e, pred))
+                return false;
+            element &succ = *e.next;
+            succ.spin.lock();
+            unlink(e);
+            succ.spin.unlock();
+            e.spin.unlock();
+            pred->spin.unlock();
+            return true;
+        }
+
+        // inserts n in front of the first element that does not come
+        // before it, walking hand over hand from the head
+        template <typename Less>
+        void insert_sorted(T &n, Less less)
+        {
+            element *cur = &head;
+            cur->spin.lock();
+            for (;;)
+            {
+                element *next = cur->next;
+                next->spin.lock();
+                if (next == &tail || less(n, cast_t(*next)))
+                {
+                    link(*cur, cast_el(n), *next);
+                    next->spin.unlock();
+                    cur->spin.unlock();
+                    return;
+                }
+                cur->spin.unlock();
+                cur = next;
+            }
+        }
+
+        // calls f on every element in order, with that element locked
+        template <typename F>
+        void for_each(F f)
+        {
+            element *cur = &head;
+            cur->spin.lock();
+            for (;;)
+            {
+                element *next = cur->next;
+                if (next == &tail)
+                {
+                    cur->spin.unlock();
+                    return;
+                }
+                next->spin.lock();
+                cur->spin.unlock();
+                f(cast_t(*next));
+                cur = next;
+            }
+        }
+
+        // erases the elements pred accepts in one walk and passes each to
+        // on_erased once it is unlocked; returns how many went
+        template <typename Pred, typename F>
+        std::size_t erase_if(Pred pred, F on_erased)
+        {
+            std::size_t n = 0;
+            element *cur = &head;
+            cur->spin.lock();
+            element *next = cur->next;
+            next->spin.lock();
+            while (next != &tail)
+            {
+                if (pred(cast_t(*next)))
+                {
+                    element *after = next->next;
+                    after->spin.lock();
+                    unlink(*next);
+                    next->spin.unlock();
+                    on_erased(cast_t(*next));
+                    n++;
+                    next = after;
+                }
+                else
+                {
+                    cur->spin.unlock();
+                    cur = next;
+                    next = cur->next;
+                    next->spin.lock();
+                }
+            }
+            next->spin.unlock();
+            cur->spin.unlock();
+            return n;
+        }
+
+        template <typename Pred>
+        std::size_t erase_if(Pred pred)
+        {
+            return erase_if(pred, [](T&) {});
+        }
+    };
+}
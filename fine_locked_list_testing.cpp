@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "fine_locked_list.h"
+
+namespace
+{
+    struct node : intrusive::fine_locked_list_element<>
+    {
+        int value = 0;
+    };
+
+    using list_type = intrusive::fine_locked_list<node>;
+
+    std::vector<int> values(list_type &l)
+    {
+        std::vector<int> res;
+        l.for_each([&](node &n) { res.push_back(n.value); });
+        return res;
+    }
+}
+
+TEST(fine_locked_list_testing, empty)
+{
+    list_type l;
+    EXPECT_TRUE(l.empty());
+    EXPECT_TRUE(values(l).empty());
+    EXPECT_EQ(0u, l.erase_if([](node&) { return true; }));
+}
+
+TEST(fine_locked_list_testing, insert_and_erase)
+{
+    std::vector<node> nodes(5);
+    for (int i = 0; i != 5; ++i)
+        nodes[i].value = i;
+    list_type l;
+    l.push_back(nodes[2]);
+    l.push_front(nodes[0]);
+    EXPECT_TRUE(l.insert_after(nodes[0], nodes[1]));
+    l.push_back(nodes[4]);
+    EXPECT_TRUE(l.insert_before(nodes[4], nodes[3]));
+    EXPECT_EQ(5u, l.size());
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), values(l));
+
+    EXPECT_TRUE(l.erase(nodes[0]));
+    EXPECT_TRUE(l.erase(nodes[3]));
+    EXPECT_FALSE(l.erase(nodes[3]));
+    EXPECT_FALSE(nodes[3].is_linked());
+    EXPECT_FALSE(l.insert_after(nodes[3], nodes[0]));
+    EXPECT_FALSE(l.insert_before(nodes[3], nodes[0]));
+    EXPECT_EQ((std::vector<int>{1, 2, 4}), values(l));
+    EXPECT_EQ(3u, l.size());
+}
+
+TEST(fine_locked_list_testing, sorted_and_erase_if)
+{
+    std::vector<node> nodes(10);
+    list_type l;
+    int order[] = {5, 1, 8, 3, 9, 0, 7, 2, 6, 4};
+    for (int i = 0; i != 10; ++i)
+    {
+        nodes[i].value = order[i];
+        l.insert_sorted(nodes[i], [](node const& a, node const& b) { return a.value < b.value; });
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), values(l));
+
+    std::vector<int> erased;
+    EXPECT_EQ(5u, l.erase_if([](node &n) { return n.value % 2 == 1; },
+                             [&](node &n) { erased.push_back(n.value); }));
+    EXPECT_EQ((std::vector<int>{1, 3, 5, 7, 9}), erased);
+    EXPECT_EQ((std::vector<int>{0, 2, 4, 6, 8}), values(l));
+    EXPECT_EQ(1u, l.erase_if([](node &n) { return n.value == 8; }));
+    EXPECT_EQ((std::vector<int>{0, 2, 4, 6}), values(l));
+}
+
+TEST(fine_locked_list_testing, concurrent_random_edits)
+{
+    // each thread moves its own nodes around at random places of a shared
+    // list, next to nodes of its own that it knows to be linked
+    constexpr int threads = 4;
+    constexpr int per_thread = 2500;
+    std::vector<node> nodes(threads * per_thread);
+    list_type l;
+    for (auto &n : nodes)
+        l.push_back(n);
+    std::atomic<bool> stop{false};
+
+    std::thread walker([&] {
+        while (!stop.load())
+        {
+            std::size_t seen = 0;
+            l.for_each([&](node&) { seen++; });
+            ASSERT_LE(seen, nodes.size());
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t != threads; ++t)
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(static_cast<unsigned>(t));
+            node *mine = &nodes[t * per_thread];
+            std::vector<bool> linked(per_thread, true);
+            for (int step = 0; step != 20000; ++step)
+            {
+                int a = static_cast<int>(rng() % per_thread);
+                int b = static_cast<int>(rng() % per_thread);
+                if (a == b || !linked[b])
+                    continue;
+                if (linked[a])
+                {
+                    ASSERT_TRUE(l.erase(mine[a]));
+                    linked[a] = false;
+                }
+                else
+                {
+                    bool after = rng() % 2;
+                    ASSERT_TRUE(after ? l.insert_after(mine[b], mine[a]) : l.insert_before(mine[b], mine[a]));
+                    linked[a] = true;
+                }
+            }
+            for (int i = 0; i != per_thread; ++i)
+                ASSERT_EQ(bool(linked[i]), l.erase(mine[i]));
+        });
+    for (auto &w : workers)
+        w.join();
+    stop.store(true);
+    walker.join();
+
+    EXPECT_TRUE(l.empty());
+    EXPECT_TRUE(values(l).empty());
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct graph_out_tag;
+    struct graph_in_tag;
+    struct graph_vertex_tag;
+    struct graph_frontier_tag;
+
+    template <typename V, typename E>
+    class graph;
+
+    // Base of edge types. An edge sits in the out-list of its source and the
+    // in-list of its target at the same time, so it is unlinked in O(1).
+    template <typename V, typename E>
+    class graph_edge
+        : public list_element<graph_out_tag>
+        , public list_element<graph_in_tag>
+    {
+    private:
+        friend class graph<V, E>;
+        V *from_ = nullptr;
+        V *to_ = nullptr;
+    public:
+        V &from() const noexcept
+        {
+            return *from_;
+        }
+        V &to() const noexcept
+        {
+            return *to_;
+        }
+        bool is_linked() const noexcept
+        {
+            return list_element<graph_out_tag>::is_linked();
+        }
+    };
+
+    // Base of vertex types; E must be complete before the vertex type is defined.
+    // The frontier hook lets traversals queue vertices without allocating.
+    template <typename V, typename E>
+    class graph_vertex
+        : public list_element<graph_vertex_tag>
+        , public list_element<graph_frontier_tag>
+    {
+    private:
+        friend class graph<V, E>;
+        list<E, graph_out_tag> out;
+        list<E, graph_in_tag> in;
+        std::size_t pending = 0;
+        std::uint64_t visited = 0;
+    public:
+        graph_vertex() = default;
+        graph_vertex(graph_vertex const&) = delete;
+        graph_vertex& operator=(graph_vertex const&) = delete;
+
+        list<E, graph_out_tag> const& out_edges() const noexcept
+        {
+            return out;
+        }
+        list<E, graph_in_tag> const& in_edges() const noexcept
+        {
+            return in;
+        }
+    };
+
+    // Directed graph over caller-owned vertices and edges.
+    // Inserting or removing an edge is O(1); BFS and topological sort queue
+    // vertices through their frontier hook and allocate nothing.
+    template <typename V, typename E>
+    class graph
+    {
+    private:
+        list<V, graph_vertex_tag> vertices;
+        std::uint64_t epoch = 0;
+
+        static graph_vertex<V, E> &base(V &v) noexcept
+        {
+            return v;
+        }
+    public:
+        graph() = default;
+        graph(graph const&) = delete;
+        graph& operator=(graph const&) = delete;
+        ~graph()
+        {
+            while (!vertices.empty())
+                remove_vertex(vertices.front());
+        }
+
+        void add_vertex(V &v) noexcept
+        {
+            vertices.push_back(v);
+        }
+
+        // detaches v together with all its edges
+        void remove_vertex(V &v) noexcept
+        {
+            auto &b = base(v);
+            while (!b.out.empty())
+                remove_edge(b.out.front());
+            while (!b.in.empty())
+                remove_edge(b.in.front());
+            static_cast<list_element<graph_vertex_tag>&>(v).unlink();
+        }
+
+        static void add_edge(E &e, V &from, V &to) noexcept
+        {
+            auto &ge = static_cast<graph_edge<V, E>&>(e);
+            ge.from_ = &from;
+            ge.to_ = &to;
+            base(from).out.push_back(e);
+            base(to).in.push_back(e);
+        }
+
+        static void remove_edge(E &e) noexcept
+        {
+            static_cast<list_element<graph_out_tag>&>(e).unlink();
+            static_cast<list_element<graph_in_tag>&>(e).unlink();
+        }
+
+        list<V, graph_vertex_tag> const& all_vertices() const noexcept
+        {
+            return vertices;
+        }
+
+        // calls f(V&) for every vertex reachable from start in BFS order
+        template <typename F>
+        void bfs(V &start, F &&f)
+        {
+            ++epoch;
+            list<V, graph_frontier_tag> frontier;
+            base(start).visited = epoch;
+            frontier.push_back(start);
+            while (!frontier.empty())
+            {
+                V &v = frontier.front();
+                frontier.pop_front();
+                for (auto it = base(v).out.begin(); it != base(v).out.end(); ++it)
+                {
+                    V &t = it->to();
+                    if (base(t).visited != epoch)
+                    {
+                        base(t).visited = epoch;
+                        frontier.push_back(t);
+                    }
+                }
+                f(v);
+            }
+        }
+
+        // Kahn's algorithm, calls f(V&) in topological order.
+        // Returns false if the graph has a cycle; then only the acyclic part is visited.
+        template <typename F>
+        bool topological_sort(F &&f)
+        {
+            list<V, graph_frontier_tag> ready;
+            std::size_t total = 0, done = 0;
+            for (auto it = vertices.begin(); it != vertices.end(); ++it)
+            {
+                auto &b = base(*it);
+                b.pending = 0;
+                for (auto e = b.in.begin(); e != b.in.end(); ++e)
+                    b.pending++;
+                if (b.pending == 0)
+                    ready.push_back(*it);
+                total++;
+            }
+            while (!ready.empty())
+            {
+                V &v = ready.front();
+                ready.pop_front();
+                for (auto it = base(v).out.begin(); it != base(v).out.end(); ++it)
+                {
+                    V &t = it->to();
+                    if (--base(t).pending == 0)
+                        ready.push_back(t);
+                }
+                done++;
+                f(v);
+            }
+            return done == total;
+        }
+    };
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "graph.h"
+
+namespace
+{
+    struct vertex;
+
+    struct edge : intrusive::graph_edge<vertex, edge>
+    {};
+
+    struct vertex : intrusive::graph_vertex<vertex, edge>
+    {
+        explicit vertex(int id = 0)
+            : id(id)
+        {}
+
+        int id;
+    };
+
+    using graph_t = intrusive::graph<vertex, edge>;
+
+    std::size_t out_degree(vertex const& v)
+    {
+        std::size_t res = 0;
+        for (auto it = v.out_edges().begin(); it != v.out_edges().end(); ++it)
+            res++;
+        return res;
+    }
+}
+
+TEST(graph_testing, edges)
+{
+    vertex a(1), b(2), c(3);
+    edge ab, ac, bc;
+    graph_t g;
+    g.add_vertex(a);
+    g.add_vertex(b);
+    g.add_vertex(c);
+    g.add_edge(ab, a, b);
+    g.add_edge(ac, a, c);
+    g.add_edge(bc, b, c);
+
+    EXPECT_EQ(2u, out_degree(a));
+    EXPECT_EQ(&a, &ab.from());
+    EXPECT_EQ(&b, &ab.to());
+    EXPECT_EQ(&ac, &c.in_edges().front());
+
+    g.remove_edge(ac);
+    EXPECT_FALSE(ac.is_linked());
+    EXPECT_EQ(1u, out_degree(a));
+    EXPECT_EQ(&bc, &c.in_edges().front());
+    EXPECT_EQ(&bc, &c.in_edges().back());
+
+    g.remove_vertex(b);
+    EXPECT_FALSE(ab.is_linked());
+    EXPECT_FALSE(bc.is_linked());
+    EXPECT_TRUE(a.out_edges().empty());
+    EXPECT_TRUE(c.in_edges().empty());
+}
+
+TEST(graph_testing, bfs)
+{
+    std::vector<vertex> v(6);
+    std::vector<edge> e(7);
+    graph_t g;
+    for (int i = 0; i != 6; ++i)
+    {
+        v[i].id = i;
+        g.add_vertex(v[i]);
+    }
+    int edges[][2] = {{0, 1}, {0, 2}, {1, 3}, {2, 3}, {3, 4}, {4, 0}, {5, 0}};
+    for (int i = 0; i != 7; ++i)
+        g.add_edge(e[i], v[edges[i][0]], v[edges[i][1]]);
+
+    std::vector<int> order;
+    g.bfs(v[0], [&](vertex &x) { order.push_back(x.id); });
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), order);
+
+    order.clear();
+    g.bfs(v[3], [&](vertex &x) { order.push_back(x.id); });
+    EXPECT_EQ((std::vector<int>{3, 4, 0, 1, 2}), order);
+}
+
+TEST(graph_testing, topological_sort)
+{
+    std::vector<vertex> v(5);
+    std::vector<edge> e(6);
+    graph_t g;
+    for (int i = 0; i != 5; ++i)
+    {
+        v[i].id = i;
+        g.add_vertex(v[i]);
+    }
+    int edges[][2] = {{3, 1}, {1, 0}, {3, 0}, {4, 2}, {2, 0}, {0, 1}};
+    for (int i = 0; i != 5; ++i)
+        g.add_edge(e[i], v[edges[i][0]], v[edges[i][1]]);
+
+    std::vector<int> order;
+    EXPECT_TRUE(g.topological_sort([&](vertex &x) { order.push_back(x.id); }));
+    ASSERT_EQ(5u, order.size());
+    auto pos = [&](int id) { return std::find(order.begin(), order.end(), id) - order.begin(); };
+    for (int i = 0; i != 5; ++i)
+        EXPECT_LT(pos(edges[i][0]), pos(edges[i][1]));
+
+    g.add_edge(e[5], v[0], v[1]);
+    order.clear();
+    EXPECT_FALSE(g.topological_sort([&](vertex &x) { order.push_back(x.id); }));
+    EXPECT_EQ(3u, order.size());
+}
+
+TEST(graph_testing, edge_churn)
+{
+    constexpr int n = 100;
+    std::vector<vertex> v(n);
+    std::vector<edge> e(2000);
+    graph_t g;
+    for (int i = 0; i != n; ++i)
+        g.add_vertex(v[i]);
+
+    std::mt19937 rng(5);
+    for (int round = 0; round != 20000; ++round)
+    {
+        edge &x = e[rng() % e.size()];
+        if (x.is_linked())
+            g.remove_edge(x);
+        else
+            g.add_edge(x, v[rng() % n], v[rng() % n]);
+    }
+
+    std::size_t linked = std::count_if(e.begin(), e.end(), [](edge const& x) { return x.is_linked(); });
+    std::size_t out = 0, in = 0;
+    for (auto &x : v)
+    {
+        out += out_degree(x);
+        for (auto it = x.in_edges().begin(); it != x.in_edges().end(); ++it)
+        {
+            EXPECT_EQ(&x, &it->to());
+            in++;
+        }
+    }
+    EXPECT_EQ(linked, out);
+    EXPECT_EQ(linked, in);
+}
@@ -26,6 +26,10 @@ namespace intrusive
                 prev->next = next;
             prev = next = nullptr;
         }
+        bool is_linked() const noexcept
+        {
+            return next != nullptr;
+        }
     };
 
     template <typename T, typename Tag = default_tag>
@@ -215,6 +219,15 @@ namespace intrusive
             return const_iterator(const_cast<list_element<Tag>*>(&root));
         }
 
+        static iterator iterator_to(T& u) noexcept
+        {
+            return iterator(&cast_el(u));
+        }
+        static const_iterator iterator_to(T const& u) noexcept
+        {
+            return const_iterator(const_cast<list_element<Tag>*>(&static_cast<list_element<Tag> const&>(u)));
+        }
+
         iterator insert(const_iterator pos, T& u) noexcept
         {
             auto &v = static_cast<list_element<Tag>&>(u);
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct iobuf_tag;
+
+    // Chunk header of an iobuf_chain.
+    // Describes the window [data(), data() + length()) of a buffer; the buffer
+    // is either shared with other headers (so splitting never copies) or
+    // external memory the caller keeps alive.
+    class iobuf : public list_element<iobuf_tag>
+    {
+    private:
+        std::shared_ptr<char[]> storage;
+        char *buf = nullptr;
+        std::size_t cap = 0;
+        std::size_t off = 0;
+        std::size_t len = 0;
+
+        iobuf() = default;
+    public:
+        iobuf(iobuf const&) = delete;
+        iobuf& operator=(iobuf const&) = delete;
+
+        // empty chunk with capacity bytes of writable room
+        static std::unique_ptr<iobuf> create(std::size_t capacity)
+        {
+            std::unique_ptr<iobuf> res(new iobuf);
+            res->storage.reset(new char[capacity]);
+            res->buf = res->storage.get();
+            res->cap = capacity;
+            return res;
+        }
+
+        // zero-copy view of memory that must outlive the chunk
+        static std::unique_ptr<iobuf> wrap(void const *data, std::size_t length)
+        {
+            std::unique_ptr<iobuf> res(new iobuf);
+            res->buf = static_cast<char*>(const_cast<void*>(data));
+            res->cap = res->len = length;
+            return res;
+        }
+
+        // new header over the same bytes
+        std::unique_ptr<iobuf> clone() const
+        {
+            std::unique_ptr<iobuf> res(new iobuf);
+            res->storage = storage;
+            res->buf = buf;
+            res->cap = cap;
+            res->off = off;
+            res->len = len;
+            return res;
+        }
+
+        char *data() noexcept
+        {
+            return buf + off;
+        }
+        char const *data() const noexcept
+        {
+            return buf + off;
+        }
+        std::size_t length() const noexcept
+        {
+            return len;
+        }
+        // room after the data that may be written without affecting other headers
+        std::size_t tailroom() const noexcept
+        {
+            if (storage == nullptr || storage.use_count() != 1)
+                return 0;
+            return cap - off - len;
+        }
+        char *tail() noexcept
+        {
+            return buf + off + len;
+        }
+
+        void append(std::size_t n) noexcept
+        {
+            assert(n <= tailroom());
+            len += n;
+        }
+        void trim_start(std::size_t n) noexcept
+        {
+            assert(n <= len);
+            off += n;
+            len -= n;
+        }
+        void trim_end(std::size_t n) noexcept
+        {
+            assert(n <= len);
+            len -= n;
+        }
+    };
+
+    // Byte stream stored as a list of chunks.
+    // Appending, prepending and splitting relink chunk headers instead of
+    // copying payload, and the chain is handed to writev/readv directly.
+    class iobuf_chain
+    {
+    private:
+        list<iobuf, iobuf_tag> chunks;
+        std::size_t bytes = 0;
+
+        static constexpr std::size_t default_chunk = 4096;
+
+        static void free_chunk(iobuf &c) noexcept
+        {
+            c.unlink();
+            delete &c;
+        }
+    public:
+        iobuf_chain() = default;
+        iobuf_chain(iobuf_chain const&) = delete;
+        iobuf_chain(iobuf_chain&& r) noexcept
+            : chunks(std::move(r.chunks))
+            , bytes(std::exchange(r.bytes, 0))
+        {}
+        iobuf_chain& operator=(iobuf_chain const&) = delete;
+        iobuf_chain& operator=(iobuf_chain&& r) noexcept
+        {
+            if (this == &r)
+                return *this;
+            clear();
+            chunks = std::move(r.chunks);
+            bytes = std::exchange(r.bytes, 0);
+            return *this;
+        }
+        ~iobuf_chain()
+        {
+            clear();
+        }
+
+        void clear() noexcept
+        {
+            while (!chunks.empty())
+                free_chunk(chunks.front());
+            bytes = 0;
+        }
+
+        bool empty() const noexcept
+        {
+            return bytes == 0;
+        }
+        std::size_t size() const noexcept
+        {
+            return bytes;
+        }
+        std::size_t chunk_count() const noexcept
+        {
+            std::size_t res = 0;
+            for (auto it = chunks.begin(); it != chunks.end(); ++it)
+                res++;
+            return res;
+        }
+
+        void append(std::unique_ptr<iobuf> c) noexcept
+        {
+            bytes += c->length();
+            chunks.push_back(*c.release());
+        }
+        void prepend(std::unique_ptr<iobuf> c) noexcept
+        {
+            bytes += c->length();
+            chunks.push_front(*c.release());
+        }
+        void append(iobuf_chain &&r) noexcept
+        {
+            bytes += std::exchange(r.bytes, 0);
+            chunks.splice(chunks.end(), r.chunks, r.chunks.begin(), r.chunks.end());
+        }
+        void prepend(iobuf_chain &&r) noexcept
+        {
+            bytes += std::exchange(r.bytes, 0);
+            chunks.splice(chunks.begin(), r.chunks, r.chunks.begin(), r.chunks.end());
+        }
+
+        // copies into the tail room of the last chunk, then into new chunks
+        void append_copy(void const *data, std::size_t n)
+        {
+            auto *src = static_cast<char const*>(data);
+            while (n != 0)
+            {
+                if (chunks.empty() || chunks.back().tailroom() == 0)
+                    append(iobuf::create(std::max(default_chunk, n)));
+                iobuf &last = chunks.back();
+                std::size_t part = std::min(n, last.tailroom());
+                std::memcpy(last.tail(), src, part);
+                last.append(part);
+                bytes += part;
+                src += part;
+                n -= part;
+            }
+        }
+
+        // detaches the first n bytes; a straddling chunk is shared, not copied
+        iobuf_chain split(std::size_t n)
+        {
+            assert(n <= bytes);
+            iobuf_chain res;
+            auto it = chunks.begin();
+            std::size_t taken = 0;
+            while (it != chunks.end() && taken + it->length() <= n)
+            {
+                taken += it->length();
+                ++it;
+            }
+            res.chunks.splice(res.chunks.end(), chunks, chunks.begin(), it);
+            res.bytes = taken;
+            bytes -= taken;
+            if (taken != n)
+            {
+                std::size_t rest = n - taken;
+                std::unique_ptr<iobuf> head = chunks.front().clone();
+                head->trim_end(head->length() - rest);
+                chunks.front().trim_start(rest);
+                bytes -= rest;
+                res.append(std::move(head));
+            }
+            return res;
+        }
+
+        // drops n bytes from the front, e.g. after a partial write
+        void trim_front(std::size_t n) noexcept
+        {
+            assert(n <= bytes);
+            bytes -= n;
+            while (n != 0)
+            {
+                iobuf &c = chunks.front();
+                if (c.length() > n)
+                {
+                    c.trim_start(n);
+                    return;
+                }
+                n -= c.length();
+                free_chunk(c);
+            }
+            while (!chunks.empty() && chunks.front().length() == 0)
+                free_chunk(chunks.front());
+        }
+
+        // gathers the whole chain into a single chunk, returns its data
+        char *coalesce()
+        {
+            if (chunks.empty())
+                return nullptr;
+            if (std::next(chunks.begin()) == chunks.end())
+                return chunks.front().data();
+            std::unique_ptr<iobuf> merged = iobuf::create(bytes);
+            copy_out(merged->tail(), bytes);
+            merged->append(bytes);
+            clear();
+            append(std::move(merged));
+            return chunks.front().data();
+        }
+
+        // copies the first n bytes without consuming them
+        void copy_out(void *dst, std::size_t n) const noexcept
+        {
+            assert(n <= bytes);
+            auto *out = static_cast<char*>(dst);
+            for (auto it = chunks.begin(); n != 0; ++it)
+            {
+                std::size_t part = std::min(n, it->length());
+                std::memcpy(out, it->data(), part);
+                out += part;
+                n -= part;
+            }
+        }
+
+        // fills up to batch iovecs from the front of the chain, returns their number
+        std::size_t to_iovec(iovec *out, std::size_t batch) const noexcept
+        {
+            std::size_t res = 0;
+            for (auto it = chunks.begin(); it != chunks.end() && res != batch; ++it)
+            {
+                if (it->length() == 0)
+                    continue;
+                out[res].iov_base = const_cast<char*>(it->data());
+                out[res].iov_len = it->length();
+                res++;
+            }
+            return res;
+        }
+
+        // one writev of up to batch chunks; written bytes are trimmed.
+        // Returns what writev returned.
+        template <std::size_t Batch = 64>
+        ssize_t write_to(int fd) noexcept
+        {
+            iovec iov[Batch];
+            std::size_t cnt = to_iovec(iov, Batch);
+            if (cnt == 0)
+                return 0;
+            ssize_t res = ::writev(fd, iov, static_cast<int>(cnt));
+            if (res > 0)
+                trim_front(static_cast<std::size_t>(res));
+            return res;
+        }
+
+        // one readv of at most max_bytes into the tail room of the last chunk
+        // and a fresh chunk. Returns what readv returned.
+        ssize_t read_from(int fd, std::size_t max_bytes)
+        {
+            iovec iov[2];
+            int cnt = 0;
+            std::size_t room = 0;
+            if (!chunks.empty() && chunks.back().tailroom() != 0)
+            {
+                room = std::min(max_bytes, chunks.back().tailroom());
+                iov[cnt].iov_base = chunks.back().tail();
+                iov[cnt].iov_len = room;
+                cnt++;
+            }
+            std::unique_ptr<iobuf> extra;
+            if (room < max_bytes)
+            {
+                extra = iobuf::create(std::max(default_chunk, max_bytes - room));
+                iov[cnt].iov_base = extra->tail();
+                iov[cnt].iov_len = max_bytes - room;
+                cnt++;
+            }
+            ssize_t res = ::readv(fd, iov, cnt);
+            if (res <= 0)
+                return res;
+            std::size_t got = static_cast<std::size_t>(res);
+            std::size_t first = std::min(got, room);
+            if (first != 0)
+            {
+                chunks.back().append(first);
+                bytes += first;
+            }
+            if (got > first)
+            {
+                extra->append(got - first);
+                append(std::move(extra));
+            }
+            return res;
+        }
+    };
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "iobuf_chain.h"
+#include "test_utils.h"
+
+namespace
+{
+    std::string to_string(intrusive::iobuf_chain const& chain)
+    {
+        std::string res(chain.size(), '\0');
+        chain.copy_out(&res[0], res.size());
+        return res;
+    }
+}
+
+TEST(iobuf_chain_testing, append_prepend)
+{
+    intrusive::iobuf_chain chain;
+    EXPECT_TRUE(chain.empty());
+    chain.append_copy("world", 5);
+    chain.prepend(intrusive::iobuf::wrap("hello ", 6));
+    chain.append(intrusive::iobuf::wrap("!", 1));
+    EXPECT_EQ(12u, chain.size());
+    EXPECT_EQ(3u, chain.chunk_count());
+    EXPECT_EQ("hello world!", to_string(chain));
+}
+
+TEST(iobuf_chain_testing, append_chain)
+{
+    intrusive::iobuf_chain a, b;
+    a.append_copy("ab", 2);
+    b.append_copy("cd", 2);
+    a.append(std::move(b));
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ("abcd", to_string(a));
+
+    b.append_copy("xy", 2);
+    a.prepend(std::move(b));
+    EXPECT_EQ("xyabcd", to_string(a));
+}
+
+TEST(iobuf_chain_testing, split)
+{
+    intrusive::iobuf_chain chain;
+    chain.append(intrusive::iobuf::wrap("abc", 3));
+    chain.append(intrusive::iobuf::wrap("defg", 4));
+    chain.append(intrusive::iobuf::wrap("hi", 2));
+
+    intrusive::iobuf_chain head = chain.split(3);
+    EXPECT_EQ("abc", to_string(head));
+    EXPECT_EQ("defghi", to_string(chain));
+
+    head = chain.split(2);
+    EXPECT_EQ("de", to_string(head));
+    EXPECT_EQ("fghi", to_string(chain));
+    EXPECT_EQ(2u, chain.chunk_count());
+
+    head = chain.split(4);
+    EXPECT_EQ("fghi", to_string(head));
+    EXPECT_TRUE(chain.empty());
+}
+
+TEST(iobuf_chain_testing, split_shares_storage)
+{
+    intrusive::iobuf_chain chain;
+    chain.append_copy("0123456789", 10);
+    intrusive::iobuf_chain head = chain.split(4);
+    EXPECT_EQ("0123", to_string(head));
+    EXPECT_EQ("456789", to_string(chain));
+    // shared buffers must not be appended into
+    head.append_copy("x", 1);
+    EXPECT_EQ("0123x", to_string(head));
+    EXPECT_EQ("456789", to_string(chain));
+}
+
+TEST(iobuf_chain_testing, trim_coalesce)
+{
+    intrusive::iobuf_chain chain;
+    chain.append(intrusive::iobuf::wrap("abc", 3));
+    chain.append(intrusive::iobuf::wrap("def", 3));
+    chain.append(intrusive::iobuf::wrap("ghi", 3));
+    chain.trim_front(4);
+    EXPECT_EQ("efghi", to_string(chain));
+    EXPECT_EQ(2u, chain.chunk_count());
+
+    char *data = chain.coalesce();
+    EXPECT_EQ(1u, chain.chunk_count());
+    EXPECT_EQ("efghi", std::string(data, 5));
+}
+
+TEST(iobuf_chain_testing, to_iovec)
+{
+    intrusive::iobuf_chain chain;
+    for (int i = 0; i != 5; ++i)
+        chain.append(intrusive::iobuf::wrap("ab", 2));
+    iovec iov[3];
+    EXPECT_EQ(3u, chain.to_iovec(iov, 3));
+    EXPECT_EQ(2u, iov[2].iov_len);
+}
+
+TEST(iobuf_chain_testing, writev_readv)
+{
+    socket_pair sp;
+    std::string expected;
+    intrusive::iobuf_chain out;
+    for (int i = 0; i != 200; ++i)
+    {
+        std::string part = std::to_string(i) + ",";
+        expected += part;
+        out.append_copy(part.data(), part.size());
+        out.append(intrusive::iobuf::wrap("|", 1));
+        expected += "|";
+    }
+
+    while (!out.empty())
+        ASSERT_GT(out.write_to(sp.fds[0]), 0);
+
+    intrusive::iobuf_chain in;
+    while (in.size() != expected.size())
+        ASSERT_GT(in.read_from(sp.fds[1], 100), 0);
+    EXPECT_EQ(expected, to_string(in));
+}
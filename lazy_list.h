@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+
+#include "epoch_reclaim.h"
+#include "spin_utils.h"
+
+namespace intrusive
+{
+    template <typename T, typename Tag, typename KeyOf, typename Less, typename Reclaim>
+    class lazy_list;
+
+    // Hook for lazy_list: the successor, a mark set when the element is
+    // logically removed and a one byte spinlock guarding both.
+    template <typename Tag = default_tag>
+    class lazy_list_element : public reclaimable
+    {
+    private:
+        template <typename FT, typename FTag, typename FKeyOf, typename FLess, typename FReclaim>
+        friend class lazy_list;
+        std::atomic<lazy_list_element*> next{nullptr};
+        std::atomic<bool> marked{false};
+        detail::byte_spinlock spin;
+    public:
+        lazy_list_element() = default;
+        lazy_list_element(lazy_list_element const&) = delete;
+        lazy_list_element& operator=(lazy_list_element const&) = delete;
+
+        bool is_linked() const noexcept
+        {
+            return next.load(std::memory_order_relaxed) != nullptr
+                && !marked.load(std::memory_order_relaxed);
+        }
+    };
+
+    // Sorted set after Heller, Herlihy, Luchangco, Moir, Scherer and Shavit.
+    // Lookups walk without locks or retries and are wait-free; insert and
+    // erase walk the same way, lock just the predecessor and the current
+    // element, check that both are unmarked and still adjacent, and start
+    // over otherwise. Erase marks the element before unlinking it, so the
+    // mark alone tells a lookup that an element it reached is gone.
+    // Erased elements go to the participant's epoch_domain and reach
+    // Reclaim once no lookup can stand on them. The key of an element must
+    // not change while it is on the list.
+    template <typename T, typename Tag = default_tag, typename KeyOf = member_key,
+              typename Less = std::less<>, typename Reclaim = no_reclaim>
+    class lazy_list
+    {
+    private:
+        using element = lazy_list_element<Tag>;
+        using participant = epoch_domain::participant;
+
+        KeyOf key_of;
+        Less less;
+        element head;
+        element tail;
+        std::atomic<std::size_t> size_{0};
+
+        static element &cast_el(T &r) noexcept
+        {
+            return static_cast<element&>(r);
+        }
+        static T const& cast_t(element const& e) noexcept
+        {
+            return static_cast<T const&>(e);
+        }
+
+        static void reclaim_element(reclaimable &r)
+        {
+            auto &e = static_cast<element&>(r);
+            e.next.store(nullptr, std::memory_order_relaxed);
+            e.marked.store(false, std::memory_order_relaxed);
+            Reclaim()(static_cast<T&>(e));
+        }
+
+        // e comes before key; the tail comes after everything
+        template <typename K>
+        bool before(element const& e, K const& key) const
+        {
+            return &e != &tail && less(key_of(cast_t(e)), key);
+        }
+        template <typename K>
+        bool matches(element const& e, K const& key) const
+        {
+            return &e != &tail && !less(key, key_of(cast_t(e)));
+        }
+
+        // pred before key, curr the first element not before it
+        template <typename K>
+        void locate(K const& key, element *&pred, element *&curr) const
+        {
+            pred = const_cast<element*>(&head);
+            curr = pred->next.load(std::memory_order_acquire);
+            while (before(*curr, key))
+            {
+                pred = curr;
+                curr = curr->next.load(std::memory_order_acquire);
+            }
+        }
+
+        template <typename K>
+        T *find_in_guard(K const& key) const
+        {
+            element *pred, *curr;
+            locate(key, pred, curr);
+            if (!matches(*curr, key) || curr->marked.load(std::memory_order_acquire))
+                return nullptr;
+            return const_cast<T*>(&cast_t(*curr));
+        }
+
+        static bool valid(element &pred, element &curr) noexcept
+        {
+            return !pred.marked.load(std::memory_order_relaxed) && !curr.marked.load(std::memory_order_relaxed)
+                && pred.next.load(std::memory_order_relaxed) == &curr;
+        }
+    public:
+        explicit lazy_list(KeyOf key_of = KeyOf(), Less less = Less())
+            : key_of(key_of)
+            , less(less)
+        {
+            head.next.store(&tail, std::memory_order_relaxed);
+        }
+        lazy_list(lazy_list const&) = delete;
+        lazy_list& operator=(lazy_list const&) = delete;
+        // no other thread may use the list any more
+        ~lazy_list()
+        {
+            element *e = head.next.load(std::memory_order_relaxed);
+            while (e != &tail)
+            {
+                element *next = e->next.load(std::memory_order_relaxed);
+                e->next.store(nullptr, std::memory_order_relaxed);
+                e = next;
+            }
+        }
+
+        std::size_t size() const noexcept
+        {
+            return size_.load(std::memory_order_relaxed);
+        }
+
+        // false when an element with the same key is already there
+        bool insert(T &n, participant &p)
+        {
+            element &e = cast_el(n);
+            assert(e.next.load(std::memory_order_relaxed) == nullptr);
+            auto const& key = key_of(n);
+            epoch_domain::guard g(p);
+            for (;;)
+            {
+                element *pred, *curr;
+                locate(key, pred, curr);
+                pred->spin.lock();
+                curr->spin.lock();
+                bool ok = valid(*pred, *curr);
+                bool inserted = false;
+                if (ok && !matches(*curr, key))
+                {
+                    e.next.store(curr, std::memory_order_relaxed);
+                    // publishes the element with its key
+                    pred->next.store(&e, std::memory_order_release);
+                    size_.fetch_add(1, std::memory_order_relaxed);
+                    inserted = true;
+                }
+                curr->spin.unlock();
+                pred->spin.unlock();
+                if (ok)
+                    return inserted;
+            }
+        }
+
+        // false when no element has the key; the erased one goes to
+        // Reclaim once no lookup can reach it
+        template <typename K>
+        bool erase(K const& key, participant &p)
+        {
+            epoch_domain::guard g(p);
+            for (;;)
+            {
+                element *pred, *curr;
+                locate(key, pred, curr);
+                pred->spin.lock();
+                curr->spin.lock();
+                bool ok = valid(*pred, *curr);
+                bool erased = false;
+                if (ok && matches(*curr, key))
+                {
+                    // logical removal first, lookups stop seeing it here
+                    curr->marked.store(true, std::memory_order_release);
+                    pred->next.store(curr->next.load(std::memory_order_relaxed), std::memory_order_release);
+                    size_.fetch_sub(1, std::memory_order_relaxed);
+                    erased = true;
+                }
+                curr->spin.unlock();
+                pred->spin.unlock();
+                if (erased)
+                    p.retire(*curr, &reclaim_element);
+                if (ok)
+                    return erased;
+            }
+        }
+
+        // wait-free membership test
+        template <typename K>
+        bool contains(K const& key, participant &p) const
+        {
+            epoch_domain::guard g(p);
+            return find_in_guard(key) != nullptr;
+        }
+
+        // the element with the key; the caller's participant must be in a
+        // critical section for as long as the result is used
+        template <typename K>
+        T *find(K const& key, participant &p) const
+        {
+            assert(p.inside());
+            (void)p;
+            return find_in_guard(key);
+        }
+
+        // visits the elements in key order, the caller's participant being
+        // in a critical section; elements erased meanwhile may show up
+        template <typename F>
+        void for_each(F f, participant &p) const
+        {
+            assert(p.inside());
+            (void)p;
+            for (element *e = head.next.load(std::memory_order_acquire); e != &tail;
+                 e = e->next.load(std::memory_order_acquire))
+                if (!e->marked.load(std::memory_order_acquire))
+                    f(const_cast<T&>(cast_t(*e)));
+        }
+    };
+}
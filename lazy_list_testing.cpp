@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lazy_list.h"
+#include "test_utils.h"
+
+namespace
+{
+    struct member : intrusive::lazy_list_element<>
+    {
+        int key = 0;
+        std::atomic<bool> reclaimed{false};
+    };
+
+    using set_type = intrusive::lazy_list<member, intrusive::default_tag, intrusive::member_key,
+                                          std::less<>, mark_reclaimed>;
+
+    struct name_tag;
+
+    struct user : intrusive::lazy_list_element<name_tag>
+    {
+        std::string name;
+    };
+
+    struct user_name
+    {
+        std::string const& operator()(user const& u) const noexcept
+        {
+            return u.name;
+        }
+    };
+
+    std::vector<int> keys(set_type const& s, intrusive::epoch_domain::participant &p)
+    {
+        intrusive::epoch_domain::guard g(p);
+        std::vector<int> res;
+        s.for_each([&](member &m) { res.push_back(m.key); }, p);
+        return res;
+    }
+}
+
+TEST(lazy_list_testing, empty)
+{
+    intrusive::epoch_domain d;
+    intrusive::epoch_domain::participant p(d);
+    set_type s;
+    EXPECT_EQ(0u, s.size());
+    EXPECT_FALSE(s.contains(1, p));
+    EXPECT_FALSE(s.erase(1, p));
+    EXPECT_TRUE(keys(s, p).empty());
+}
+
+TEST(lazy_list_testing, insert_contains_erase)
+{
+    std::vector<member> members(6);
+    {
+        intrusive::epoch_domain d;
+        intrusive::epoch_domain::participant p(d);
+        set_type s;
+        int order[] = {4, 1, 5, 0, 3, 2};
+        for (int i = 0; i != 6; ++i)
+        {
+            members[i].key = order[i];
+            EXPECT_TRUE(s.insert(members[i], p));
+        }
+        EXPECT_EQ(6u, s.size());
+        EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5}), keys(s, p));
+
+        member dup;
+        dup.key = 3;
+        EXPECT_FALSE(s.insert(dup, p));
+        EXPECT_FALSE(dup.is_linked());
+
+        EXPECT_TRUE(s.contains(3, p));
+        EXPECT_TRUE(s.erase(3, p));
+        EXPECT_FALSE(s.contains(3, p));
+        EXPECT_FALSE(s.erase(3, p));
+        EXPECT_FALSE(members[4].is_linked());
+        EXPECT_FALSE(s.contains(7, p));
+        EXPECT_TRUE(s.erase(0, p));
+        EXPECT_TRUE(s.erase(5, p));
+        EXPECT_EQ((std::vector<int>{1, 2, 4}), keys(s, p));
+        EXPECT_EQ(3u, s.size());
+        {
+            intrusive::epoch_domain::guard g(p);
+            EXPECT_EQ(&members[1], s.find(1, p));
+            EXPECT_EQ(nullptr, s.find(0, p));
+        }
+        EXPECT_FALSE(members[4].reclaimed.load());
+    }
+    // keys 5, 0 and 3
+    for (int i : {2, 3, 4})
+        EXPECT_TRUE(members[i].reclaimed.load());
+    EXPECT_FALSE(members[0].reclaimed.load());
+}
+
+TEST(lazy_list_testing, custom_key)
+{
+    std::vector<user> users(3);
+    intrusive::epoch_domain d;
+    intrusive::epoch_domain::participant p(d);
+    intrusive::lazy_list<user, name_tag, user_name> s;
+    const char *names[] = {"carol", "alice", "bob"};
+    for (int i = 0; i != 3; ++i)
+    {
+        users[i].name = names[i];
+        s.insert(users[i], p);
+    }
+    std::vector<std::string> seen;
+    {
+        intrusive::epoch_domain::guard g(p);
+        s.for_each([&](user &u) { seen.push_back(u.name); }, p);
+    }
+    EXPECT_EQ((std::vector<std::string>{"alice", "bob", "carol"}), seen);
+    EXPECT_TRUE(s.contains(std::string("bob"), p));
+    EXPECT_TRUE(s.erase(std::string("bob"), p));
+    EXPECT_FALSE(s.contains(std::string("bob"), p));
+}
+
+TEST(lazy_list_testing, concurrent_mix)
+{
+    // 90% contains of any key, 9% insert and 1% erase of the keys k with
+    // k % threads == t, whose membership thread t therefore knows
+    constexpr int threads = 4;
+    constexpr int key_range = 512;
+    std::vector<member> members(key_range);
+    for (int k = 0; k != key_range; ++k)
+    {
+        members[k].key = k;
+        members[k].reclaimed.store(true);
+    }
+    intrusive::epoch_domain d;
+    set_type s;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t != threads; ++t)
+        workers.emplace_back([&, t] {
+            intrusive::epoch_domain::participant p(d);
+            std::mt19937 rng(static_cast<unsigned>(t));
+            std::vector<bool> in(key_range, false);
+            for (int step = 0; step != 40000; ++step)
+            {
+                unsigned op = rng() % 100;
+                if (op < 90)
+                {
+                    int k = static_cast<int>(rng() % key_range);
+                    bool found = s.contains(k, p);
+                    ASSERT_TRUE(k % threads != t || found == in[k]);
+                    continue;
+                }
+                int k = t + threads * static_cast<int>(rng() % (key_range / threads));
+                if (op < 99)
+                {
+                    // a key erased earlier comes back once its element did
+                    if (in[k] || !members[k].reclaimed.load())
+                    {
+                        p.collect();
+                        continue;
+                    }
+                    members[k].reclaimed.store(false);
+                    ASSERT_TRUE(s.insert(members[k], p));
+                    in[k] = true;
+                }
+                else
+                {
+                    ASSERT_EQ(bool(in[k]), s.erase(k, p));
+                    in[k] = false;
+                }
+            }
+            for (int k = t; k < key_range; k += threads)
+                ASSERT_EQ(bool(in[k]), s.erase(k, p));
+        });
+    for (auto &w : workers)
+        w.join();
+
+    intrusive::epoch_domain::participant p(d);
+    EXPECT_EQ(0u, s.size());
+    EXPECT_TRUE(keys(s, p).empty());
+}
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include "epoch_reclaim.h"
+
+namespace intrusive
+{
+    template <typename T, typename Tag, typename Reclaim>
+    class lockfree_list;
+
+    // Hook for lockfree_list. The low bit of next marks the element as
+    // erased, which freezes next for good; prev is only a hint pointing at
+    // some element before this one.
+    template <typename Tag = default_tag>
+    class lockfree_list_element : public reclaimable
+    {
+    private:
+        template <typename FT, typename FTag, typename FReclaim>
+        friend class lockfree_list;
+        std::atomic<std::uintptr_t> next{0};
+        std::atomic<lockfree_list_element*> prev{nullptr};
+    public:
+        lockfree_list_element() = default;
+        lockfree_list_element(lockfree_list_element const&) = delete;
+        lockfree_list_element& operator=(lockfree_list_element const&) = delete;
+
+        // on a list and not erased
+        bool is_linked() const noexcept
+        {
+            std::uintptr_t w = next.load(std::memory_order_relaxed);
+            return w != 0 && (w & 1) == 0;
+        }
+    };
+
+    // Lock-free doubly linked list in the spirit of Sundell and Tsigas.
+    // The next pointers carry the list, as in Harris' singly linked list:
+    // erase marks the element, then it is unlinked from its predecessor by
+    // whoever gets there first. The prev pointers are hints to find that
+    // predecessor without a walk from the head; every operation that changes
+    // who precedes an element corrects its prev before it returns, and a
+    // hint is only used after the element was seen unmarked behind it.
+    // Erased elements are retired to an epoch_domain and handed to Reclaim
+    // once no thread can still be reading them. Every operation runs in a
+    // critical section of the given participant; iteration, begin and empty
+    // need the caller to hold one for as long as it uses the result.
+    template <typename T, typename Tag = default_tag, typename Reclaim = no_reclaim>
+    class lockfree_list
+    {
+    private:
+        using element = lockfree_list_element<Tag>;
+        using participant = epoch_domain::participant;
+
+        static constexpr std::uintptr_t erased = 1;
+
+        element head;
+        element tail;
+
+        static element *ptr(std::uintptr_t w) noexcept
+        {
+            return reinterpret_cast<element*>(w & ~erased);
+        }
+        static std::uintptr_t word(element *e) noexcept
+        {
+            return reinterpret_cast<std::uintptr_t>(e);
+        }
+        static element &cast_el(T &r) noexcept
+        {
+            return static_cast<element&>(r);
+        }
+
+        static void reclaim_element(reclaimable &r)
+        {
+            auto &e = static_cast<element&>(r);
+            e.next.store(0, std::memory_order_relaxed);
+            e.prev.store(nullptr, std::memory_order_relaxed);
+            Reclaim()(static_cast<T&>(e));
+        }
+
+        // first element at or after e that is not erased
+        static element *skip_erased(element *e) noexcept
+        {
+            std::uintptr_t w;
+            while ((w = e->next.load()) & erased)
+                e = ptr(w);
+            return e;
+        }
+
+        // where to start looking for the predecessor of x
+        element *hint_for(element &x) noexcept
+        {
+            element *h = x.prev.load();
+            // the hint is trustworthy only while x is still linked
+            if (h == nullptr || (x.next.load() & erased))
+                return &head;
+            return h;
+        }
+
+        // The element whose next points at x, walking from start, which
+        // must come before x; erased elements met on the way are unlinked.
+        // nullptr when x is not on the list.
+        element *find_pred(element &x, element *start) noexcept
+        {
+            element *cur = start;
+            for (;;)
+            {
+                std::uintptr_t w = cur->next.load();
+                if (w & erased)
+                {
+                    cur = &head;
+                    continue;
+                }
+                element *nxt = ptr(w);
+                if (nxt == &x)
+                    return cur;
+                if (nxt == nullptr)
+                    return nullptr;
+                std::uintptr_t nw = nxt->next.load();
+                if (nw & erased)
+                {
+                    cur->next.compare_exchange_strong(w, nw & ~erased);
+                    continue;
+                }
+                cur = nxt;
+            }
+        }
+
+        // points s.prev at its real predecessor, done when s is erased
+        void correct_prev(element &s, element *start) noexcept
+        {
+            for (;;)
+            {
+                if (s.next.load() & erased)
+                    return;
+                element *p = find_pred(s, start);
+                if (p == nullptr)
+                    return;
+                s.prev.store(p);
+                // another corrector may have stored an older hint meanwhile
+                if (p->next.load() == word(&s) && s.prev.load() == p)
+                    return;
+                start = &head;
+            }
+        }
+
+        bool link_after(element &pos, element &n) noexcept
+        {
+            std::uintptr_t w = pos.next.load();
+            for (;;)
+            {
+                if (w & erased)
+                    return false;
+                n.prev.store(&pos, std::memory_order_relaxed);
+                n.next.store(w, std::memory_order_relaxed);
+                if (pos.next.compare_exchange_weak(w, word(&n)))
+                    break;
+            }
+            correct_prev(*ptr(w), &n);
+            return true;
+        }
+
+        bool link_before(element &pos, element &n) noexcept
+        {
+            for (;;)
+            {
+                element *p = find_pred(pos, hint_for(pos));
+                if (p == nullptr || (pos.next.load() & erased))
+                    return false;
+                std::uintptr_t w = word(&pos);
+                n.prev.store(p, std::memory_order_relaxed);
+                n.next.store(w, std::memory_order_relaxed);
+                if (p->next.compare_exchange_strong(w, word(&n)))
+                    break;
+            }
+            correct_prev(pos, &n);
+            return true;
+        }
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T*;
+            using reference = T&;
+        private:
+            friend lockfree_list;
+            element *me;
+            explicit iterator(element *e) noexcept
+                : me(e)
+            {}
+        public:
+            iterator() noexcept
+                : me(nullptr)
+            {}
+            reference operator*() const noexcept
+            {
+                return static_cast<T&>(*me);
+            }
+            pointer operator->() const noexcept
+            {
+                return static_cast<T*>(me);
+            }
+            // an erased element still leads forward to live ones
+            iterator& operator++() noexcept
+            {
+                me = skip_erased(ptr(me->next.load()));
+                return *this;
+            }
+            iterator operator++(int) noexcept
+            {
+                iterator copy = *this;
+                ++*this;
+                return copy;
+            }
+            bool operator==(iterator const& r) const noexcept
+            {
+                return me == r.me;
+            }
+            bool operator!=(iterator const& r) const noexcept
+            {
+                return me != r.me;
+            }
+        };
+
+        lockfree_list() noexcept
+        {
+            head.next.store(word(&tail), std::memory_order_relaxed);
+            tail.prev.store(&head, std::memory_order_relaxed);
+        }
+        lockfree_list(lockfree_list const&) = delete;
+        lockfree_list& operator=(lockfree_list const&) = delete;
+        // no other thread may use the list any more; erased elements
+        // still in limbo are reclaimed later as usual
+        ~lockfree_list()
+        {
+            element *e = ptr(head.next.load());
+            while (e != &tail)
+            {
+                element *next = ptr(e->next.load());
+                if ((e->next.load() & erased) == 0)
+                {
+                    e->next.store(0, std::memory_order_relaxed);
+                    e->prev.store(nullptr, std::memory_order_relaxed);
+                }
+                e = next;
+            }
+        }
+
+        iterator begin() noexcept
+        {
+            return iterator(skip_erased(ptr(head.next.load())));
+        }
+        iterator end() noexcept
+        {
+            return iterator(&tail);
+        }
+        bool empty() noexcept
+        {
+            return begin() == end();
+        }
+
+        void push_front(T &n, participant &p) noexcept
+        {
+            assert(!cast_el(n).is_linked());
+            epoch_domain::guard g(p);
+            link_after(head, cast_el(n));
+        }
+        void push_back(T &n, participant &p) noexcept
+        {
+            assert(!cast_el(n).is_linked());
+            epoch_domain::guard g(p);
+            link_before(tail, cast_el(n));
+        }
+
+        // false when pos was erased first, n stays unlinked then
+        bool insert_after(T &pos, T &n, participant &p) noexcept
+        {
+            assert(!cast_el(n).is_linked());
+            epoch_domain::guard g(p);
+            return link_after(cast_el(pos), cast_el(n));
+        }
+        bool insert_before(T &pos, T &n, participant &p) noexcept
+        {
+            assert(!cast_el(n).is_linked());
+            epoch_domain::guard g(p);
+            return link_before(cast_el(pos), cast_el(n));
+        }
+
+        // false when somebody else erased x first; on success x goes to
+        // Reclaim once no reader can reach it
+        bool erase(T &x, participant &p) noexcept
+        {
+            element &e = cast_el(x);
+            epoch_domain::guard g(p);
+            // read before the mark, when a hint can still be trusted
+            element *start = e.prev.load();
+            std::uintptr_t w = e.next.load();
+            do
+            {
+                if (w == 0 || (w & erased))
+                    return false;
+            }
+            while (!e.next.compare_exchange_weak(w, w | erased));
+
+            for (;;)
+            {
+                element *pred = find_pred(e, start);
+                if (pred == nullptr)
+                    break;
+                start = pred;
+                std::uintptr_t expected = word(&e);
+                // next is frozen now, this is the successor for good
+                if (pred->next.compare_exchange_strong(expected, e.next.load() & ~erased))
+                    break;
+            }
+            correct_prev(*ptr(e.next.load()), start);
+            p.retire(e, &reclaim_element);
+            return true;
+        }
+    };
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "lockfree_list.h"
+
+namespace
+{
+    struct item : intrusive::lockfree_list_element<>
+    {
+        int id = 0;
+        int owner = 0;
+        std::atomic<int> reclaimed{0};
+    };
+
+    struct count_reclaim
+    {
+        void operator()(item &i) const noexcept
+        {
+            i.reclaimed.fetch_add(1);
+        }
+    };
+
+    using list_type = intrusive::lockfree_list<item, intrusive::default_tag, count_reclaim>;
+
+    std::vector<int> ids(list_type &l, intrusive::epoch_domain::participant &p)
+    {
+        intrusive::epoch_domain::guard g(p);
+        std::vector<int> res;
+        for (auto it = l.begin(); it != l.end(); ++it)
+            res.push_back(it->id);
+        return res;
+    }
+}
+
+TEST(lockfree_list_testing, empty)
+{
+    intrusive::epoch_domain d;
+    intrusive::epoch_domain::participant p(d);
+    list_type l;
+    intrusive::epoch_domain::guard g(p);
+    EXPECT_TRUE(l.empty());
+    EXPECT_TRUE(l.begin() == l.end());
+}
+
+TEST(lockfree_list_testing, insert_and_erase)
+{
+    std::vector<item> items(6);
+    for (int i = 0; i != 6; ++i)
+        items[i].id = i;
+    {
+        intrusive::epoch_domain d;
+        intrusive::epoch_domain::participant p(d);
+        list_type l;
+        l.push_back(items[2], p);
+        l.push_front(items[0], p);
+        l.push_back(items[4], p);
+        EXPECT_TRUE(l.insert_after(items[0], items[1], p));
+        EXPECT_TRUE(l.insert_before(items[4], items[3], p));
+        EXPECT_TRUE(l.insert_after(items[4], items[5], p));
+        EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5}), ids(l, p));
+
+        EXPECT_TRUE(l.erase(items[2], p));
+        EXPECT_FALSE(l.erase(items[2], p));
+        EXPECT_TRUE(l.erase(items[0], p));
+        EXPECT_TRUE(l.erase(items[5], p));
+        EXPECT_FALSE(items[2].is_linked());
+        EXPECT_TRUE(items[3].is_linked());
+        EXPECT_EQ((std::vector<int>{1, 3, 4}), ids(l, p));
+
+        // positions that are gone refuse neighbours
+        item extra;
+        EXPECT_FALSE(l.insert_before(items[2], extra, p));
+        EXPECT_FALSE(l.insert_after(items[2], extra, p));
+        EXPECT_FALSE(extra.is_linked());
+        // still in limbo, nobody collected yet
+        EXPECT_EQ(0, items[2].reclaimed.load());
+    }
+    // the participant left its limbo to the domain, which hands it back last
+    for (int i : {0, 2, 5})
+        EXPECT_EQ(1, items[i].reclaimed.load());
+    EXPECT_EQ(0, items[1].reclaimed.load());
+}
+
+TEST(lockfree_list_testing, reclaim_waits_for_readers)
+{
+    std::vector<item> items(3);
+    intrusive::epoch_domain d;
+    intrusive::epoch_domain::participant writer(d);
+    intrusive::epoch_domain::participant reader(d);
+    list_type l;
+    for (auto &i : items)
+        l.push_back(i, writer);
+    {
+        intrusive::epoch_domain::guard g(reader);
+        auto it = l.begin();
+        ASSERT_EQ(&items[0], &*it);
+        l.erase(items[0], writer);
+        l.erase(items[1], writer);
+        for (int i = 0; i != 10; ++i)
+            writer.collect();
+        // the reader may still step through both
+        EXPECT_EQ(0, items[0].reclaimed.load());
+        EXPECT_EQ(0, items[1].reclaimed.load());
+        ++it;
+        EXPECT_EQ(&items[2], &*it);
+    }
+    for (int i = 0; i != 10; ++i)
+        writer.collect();
+    EXPECT_EQ(1, items[0].reclaimed.load());
+    EXPECT_EQ(1, items[1].reclaimed.load());
+}
+
+TEST(lockfree_list_testing, concurrent_edits)
+{
+    // every thread edits its own items at random positions among the
+    // items of the others, then erases everything it added
+    constexpr int threads = 4;
+    constexpr int per_thread = 300;
+    std::vector<item> items(threads * per_thread);
+    intrusive::epoch_domain d;
+    list_type l;
+    std::atomic<bool> stop{false};
+
+    std::thread observer([&] {
+        intrusive::epoch_domain::participant p(d);
+        while (!stop.load())
+        {
+            intrusive::epoch_domain::guard g(p);
+            // items of one owner stay in their insertion order
+            std::vector<int> last(threads, -1);
+            for (auto it = l.begin(); it != l.end(); ++it)
+            {
+                ASSERT_LT(last[it->owner], it->id);
+                last[it->owner] = it->id;
+            }
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t != threads; ++t)
+        workers.emplace_back([&, t] {
+            intrusive::epoch_domain::participant p(d);
+            std::mt19937 rng(static_cast<unsigned>(t));
+            item *mine = &items[t * per_thread];
+            for (int round = 0; round != 5; ++round)
+            {
+                // ids grow along the list, so new items go after older ones
+                for (int i = 0; i != per_thread; ++i)
+                {
+                    mine[i].owner = t;
+                    mine[i].id = round * per_thread + i;
+                    if (i == 0 || rng() % 2)
+                        l.push_back(mine[i], p);
+                    else
+                        ASSERT_TRUE(l.insert_after(mine[i - 1], mine[i], p));
+                }
+                for (int i = 0; i != per_thread; ++i)
+                {
+                    bool erase_now = rng() % 3 == 0;
+                    ASSERT_TRUE(!erase_now || l.erase(mine[i], p));
+                }
+                for (int i = per_thread; i-- != 0;)
+                    l.erase(mine[i], p);
+                // wait until all of them came back before reusing them
+                for (int i = 0; i != per_thread; ++i)
+                    while (mine[i].reclaimed.load() != round + 1)
+                    {
+                        p.collect();
+                        std::this_thread::yield();
+                    }
+            }
+        });
+    for (auto &w : workers)
+        w.join();
+    stop.store(true);
+    observer.join();
+
+    intrusive::epoch_domain::participant p(d);
+    EXPECT_TRUE(ids(l, p).empty());
+    for (auto &i : items)
+        EXPECT_EQ(5, i.reclaimed.load());
+}
@@ -510,6 +510,39 @@ TEST(intrusive_list_testing, erase_03)
     EXPECT_EQ(2, it2->value);
 }
 
+TEST(intrusive_list_testing, is_linked)
+{
+    node a(1), b(2), c(3);
+    EXPECT_FALSE(a.is_linked());
+    {
+        intrusive::list<node> list;
+        mass_push_back(list, a, b, c);
+        EXPECT_TRUE(a.is_linked());
+        EXPECT_TRUE(b.is_linked());
+        list.erase(list.begin());
+        EXPECT_FALSE(a.is_linked());
+        b.unlink();
+        EXPECT_FALSE(b.is_linked());
+        EXPECT_TRUE(c.is_linked());
+    }
+    EXPECT_FALSE(c.is_linked());
+}
+
+TEST(intrusive_list_testing, iterator_to)
+{
+    intrusive::list<node> list;
+    node a(1), b(2), c(3);
+    mass_push_back(list, a, b, c);
+    auto it = intrusive::list<node>::iterator_to(b);
+    EXPECT_EQ(2, it->value);
+    EXPECT_TRUE(std::next(list.begin()) == it);
+    list.splice(list.begin(), list, it, std::next(it));
+    expect_eq(list, {2, 1, 3});
+
+    intrusive::list<node>::const_iterator cit = intrusive::list<node>::iterator_to(std::as_const(c));
+    EXPECT_EQ(&c, &*cit);
+}
+
 TEST(intrusive_list_testing, splice_begin_begin)
 {
     intrusive::list<node> c1, c2;
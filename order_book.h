@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct order_tag;
+
+    enum class side
+    {
+        buy,
+        sell,
+    };
+
+    // Resting or incoming order; quantity is the part not executed yet.
+    struct order : list_element<order_tag>
+    {
+        order(std::uint64_t id, intrusive::side side, std::int64_t price, std::uint64_t quantity) noexcept
+            : id(id)
+            , side(side)
+            , price(price)
+            , quantity(quantity)
+        {}
+
+        std::uint64_t id;
+        intrusive::side side;
+        std::int64_t price;
+        std::uint64_t quantity;
+    };
+
+    // Price-time priority limit order book over a fixed tick range.
+    // Every price level is an intrusive FIFO of orders indexed directly by
+    // price, so cancel is an unlink and orders consumed by a fill leave their
+    // level with one splice. Orders are owned by the caller.
+    class order_book
+    {
+    private:
+        struct price_level
+        {
+            list<order, order_tag> orders;
+            std::uint64_t quantity = 0;
+        };
+
+        std::int64_t min_price;
+        std::int64_t max_price;
+        std::vector<price_level> bids;
+        std::vector<price_level> asks;
+        // index of the best level or -1
+        std::ptrdiff_t best_bid_idx = -1;
+        std::ptrdiff_t best_ask_idx = -1;
+        std::unordered_map<std::uint64_t, order*> by_id;
+
+        std::ptrdiff_t index(std::int64_t price) const noexcept
+        {
+            return static_cast<std::ptrdiff_t>(price - min_price);
+        }
+        std::ptrdiff_t levels() const noexcept
+        {
+            return static_cast<std::ptrdiff_t>(bids.size());
+        }
+
+        void refresh_best_bid() noexcept
+        {
+            while (best_bid_idx >= 0 && bids[best_bid_idx].orders.empty())
+                best_bid_idx--;
+        }
+        void refresh_best_ask() noexcept
+        {
+            while (best_ask_idx >= 0 && asks[best_ask_idx].orders.empty())
+                if (++best_ask_idx == levels())
+                    best_ask_idx = -1;
+        }
+
+        // fills up to qty from one level, whole orders are spliced to filled
+        std::uint64_t fill_level(price_level &lvl, std::uint64_t qty, list<order, order_tag> &filled)
+        {
+            std::uint64_t done = 0;
+            auto it = lvl.orders.begin();
+            while (it != lvl.orders.end() && done + it->quantity <= qty)
+            {
+                done += it->quantity;
+                it->quantity = 0;
+                by_id.erase(it->id);
+                ++it;
+            }
+            filled.splice(filled.end(), lvl.orders, lvl.orders.begin(), it);
+            if (it != lvl.orders.end() && done != qty)
+            {
+                it->quantity -= qty - done;
+                done = qty;
+            }
+            lvl.quantity -= done;
+            return done;
+        }
+
+        std::uint64_t match(intrusive::side aggressor, std::int64_t limit, std::uint64_t qty,
+                            list<order, order_tag> &filled)
+        {
+            std::uint64_t done = 0;
+            if (aggressor == side::buy)
+            {
+                while (done != qty && best_ask_idx >= 0 && min_price + best_ask_idx <= limit)
+                {
+                    done += fill_level(asks[best_ask_idx], qty - done, filled);
+                    refresh_best_ask();
+                }
+            }
+            else
+            {
+                while (done != qty && best_bid_idx >= 0 && min_price + best_bid_idx >= limit)
+                {
+                    done += fill_level(bids[best_bid_idx], qty - done, filled);
+                    refresh_best_bid();
+                }
+            }
+            return done;
+        }
+    public:
+        // accepts prices in [min_price, max_price]
+        order_book(std::int64_t min_price, std::int64_t max_price)
+            : min_price(min_price)
+            , max_price(max_price)
+            , bids(static_cast<std::size_t>(max_price - min_price + 1))
+            , asks(static_cast<std::size_t>(max_price - min_price + 1))
+        {
+            assert(min_price <= max_price);
+        }
+        order_book(order_book const&) = delete;
+        order_book& operator=(order_book const&) = delete;
+
+        // Matches o against the opposite side, then rests the remainder.
+        // Resting orders executed completely are appended to filled.
+        // Returns the executed quantity.
+        std::uint64_t add(order &o, list<order, order_tag> &filled)
+        {
+            assert(o.price >= min_price && o.price <= max_price);
+            assert(!o.is_linked());
+            std::uint64_t done = match(o.side, o.price, o.quantity, filled);
+            o.quantity -= done;
+            if (o.quantity == 0)
+                return done;
+
+            std::ptrdiff_t idx = index(o.price);
+            if (o.side == side::buy)
+            {
+                bids[idx].orders.push_back(o);
+                bids[idx].quantity += o.quantity;
+                if (idx > best_bid_idx)
+                    best_bid_idx = idx;
+            }
+            else
+            {
+                asks[idx].orders.push_back(o);
+                asks[idx].quantity += o.quantity;
+                if (best_ask_idx < 0 || idx < best_ask_idx)
+                    best_ask_idx = idx;
+            }
+            by_id[o.id] = &o;
+            return done;
+        }
+
+        // market order against the given side's opposite
+        std::uint64_t execute(intrusive::side aggressor, std::uint64_t qty, list<order, order_tag> &filled)
+        {
+            return match(aggressor, aggressor == side::buy ? max_price : min_price, qty, filled);
+        }
+
+        // o must rest in this book or be unlinked
+        void cancel(order &o) noexcept
+        {
+            if (!o.is_linked())
+                return;
+            assert(find(o.id) == &o);
+            auto &lvl = o.side == side::buy ? bids[index(o.price)] : asks[index(o.price)];
+            lvl.quantity -= o.quantity;
+            o.unlink();
+            by_id.erase(o.id);
+            if (o.side == side::buy)
+                refresh_best_bid();
+            else
+                refresh_best_ask();
+        }
+
+        // returns false if no such order rests in the book
+        bool cancel(std::uint64_t id) noexcept
+        {
+            order *o = find(id);
+            if (o == nullptr)
+                return false;
+            cancel(*o);
+            return true;
+        }
+
+        // reduces a resting order, cancelling it when nothing is left
+        void reduce(order &o, std::uint64_t qty) noexcept
+        {
+            if (qty >= o.quantity)
+            {
+                cancel(o);
+                return;
+            }
+            auto &lvl = o.side == side::buy ? bids[index(o.price)] : asks[index(o.price)];
+            lvl.quantity -= qty;
+            o.quantity -= qty;
+        }
+
+        order *find(std::uint64_t id) const noexcept
+        {
+            auto it = by_id.find(id);
+            return it == by_id.end() ? nullptr : it->second;
+        }
+
+        bool has_bid() const noexcept
+        {
+            return best_bid_idx >= 0;
+        }
+        bool has_ask() const noexcept
+        {
+            return best_ask_idx >= 0;
+        }
+        std::int64_t best_bid() const noexcept
+        {
+            assert(has_bid());
+            return min_price + best_bid_idx;
+        }
+        std::int64_t best_ask() const noexcept
+        {
+            assert(has_ask());
+            return min_price + best_ask_idx;
+        }
+
+        // total resting quantity at a price on the given side
+        std::uint64_t depth(intrusive::side s, std::int64_t price) const noexcept
+        {
+            return (s == side::buy ? bids : asks)[index(price)].quantity;
+        }
+
+        // orders resting at a price in priority order
+        list<order, order_tag> const& level(intrusive::side s, std::int64_t price) const noexcept
+        {
+            return (s == side::buy ? bids : asks)[index(price)].orders;
+        }
+    };
+}
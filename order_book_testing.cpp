@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+#include "order_book.h"
+
+using intrusive::order;
+using intrusive::side;
+
+namespace
+{
+    using order_list = intrusive::list<order, intrusive::order_tag>;
+
+    std::size_t count(order_list const& l)
+    {
+        std::size_t res = 0;
+        for (auto it = l.begin(); it != l.end(); ++it)
+            res++;
+        return res;
+    }
+}
+
+TEST(order_book_testing, rest_and_best)
+{
+    order b1(1, side::buy, 100, 10), b2(2, side::buy, 101, 5);
+    order a1(3, side::sell, 105, 7), a2(4, side::sell, 103, 3);
+    order_list filled;
+    intrusive::order_book book(90, 110);
+    EXPECT_FALSE(book.has_bid());
+    EXPECT_FALSE(book.has_ask());
+
+    EXPECT_EQ(0u, book.add(b1, filled));
+    EXPECT_EQ(0u, book.add(b2, filled));
+    EXPECT_EQ(0u, book.add(a1, filled));
+    EXPECT_EQ(0u, book.add(a2, filled));
+    EXPECT_TRUE(filled.empty());
+    EXPECT_EQ(101, book.best_bid());
+    EXPECT_EQ(103, book.best_ask());
+    EXPECT_EQ(10u, book.depth(side::buy, 100));
+    EXPECT_EQ(&a1, book.find(3));
+
+    book.cancel(b2);
+    EXPECT_EQ(100, book.best_bid());
+    EXPECT_TRUE(book.cancel(4));
+    EXPECT_FALSE(book.cancel(4));
+    EXPECT_EQ(105, book.best_ask());
+    EXPECT_EQ(nullptr, book.find(4));
+}
+
+TEST(order_book_testing, fifo_fill)
+{
+    order a1(1, side::sell, 100, 5), a2(2, side::sell, 100, 5), a3(3, side::sell, 100, 5);
+    order a4(4, side::sell, 101, 5);
+    order buy(10, side::buy, 101, 13);
+    order_list filled;
+    intrusive::order_book book(90, 110);
+    book.add(a1, filled);
+    book.add(a2, filled);
+    book.add(a3, filled);
+    book.add(a4, filled);
+
+    EXPECT_EQ(13u, book.add(buy, filled));
+    EXPECT_EQ(2u, count(filled));
+    EXPECT_EQ(1u, filled.front().id);
+    EXPECT_EQ(2u, filled.back().id);
+    EXPECT_EQ(2u, a3.quantity);
+    EXPECT_FALSE(buy.is_linked());
+    EXPECT_EQ(100, book.best_ask());
+    EXPECT_EQ(2u, book.depth(side::sell, 100));
+
+    order big(11, side::buy, 101, 20);
+    filled.clear();
+    EXPECT_EQ(7u, book.add(big, filled));
+    EXPECT_EQ(2u, count(filled));
+    EXPECT_FALSE(book.has_ask());
+    EXPECT_EQ(101, book.best_bid());
+    EXPECT_EQ(13u, big.quantity);
+}
+
+TEST(order_book_testing, execute_reduce)
+{
+    order b1(1, side::buy, 100, 5), b2(2, side::buy, 99, 5);
+    order_list filled;
+    intrusive::order_book book(90, 110);
+    book.add(b1, filled);
+    book.add(b2, filled);
+
+    book.reduce(b1, 2);
+    EXPECT_EQ(3u, book.depth(side::buy, 100));
+    EXPECT_EQ(6u, book.execute(side::sell, 6, filled));
+    EXPECT_EQ(1u, count(filled));
+    EXPECT_EQ(99, book.best_bid());
+    EXPECT_EQ(2u, b2.quantity);
+    book.reduce(b2, 5);
+    EXPECT_FALSE(book.has_bid());
+}
+
+TEST(order_book_testing, replay)
+{
+    // compares against a map of deques on synthetic add/cancel/execute messages
+    std::vector<std::unique_ptr<order>> orders;
+    std::map<std::int64_t, std::deque<order*>> ref[2];
+    order_list filled;
+    intrusive::order_book book(0, 63);
+    std::mt19937 rng(3);
+
+    auto ref_remove = [&](order *o) {
+        auto &q = ref[static_cast<int>(o->side)][o->price];
+        for (auto it = q.begin(); it != q.end(); ++it)
+            if (*it == o)
+            {
+                q.erase(it);
+                break;
+            }
+        if (q.empty())
+            ref[static_cast<int>(o->side)].erase(o->price);
+    };
+
+    for (std::uint64_t i = 0; i != 20000; ++i)
+    {
+        unsigned op = rng() % 10;
+        if (op < 6)
+        {
+            side s = rng() % 2 ? side::buy : side::sell;
+            std::int64_t price = s == side::buy ? 16 + rng() % 24 : 24 + rng() % 24;
+            orders.push_back(std::make_unique<order>(i, s, price, 1 + rng() % 10));
+            order &o = *orders.back();
+
+            std::uint64_t left = o.quantity;
+            auto &opp = ref[s == side::buy ? 1 : 0];
+            while (left != 0 && !opp.empty())
+            {
+                auto lvl = s == side::buy ? opp.begin() : std::prev(opp.end());
+                if (s == side::buy ? lvl->first > price : lvl->first < price)
+                    break;
+                order *r = lvl->second.front();
+                std::uint64_t q = std::min(left, r->quantity);
+                left -= q;
+                if (q == r->quantity)
+                {
+                    lvl->second.pop_front();
+                    if (lvl->second.empty())
+                        opp.erase(lvl);
+                }
+            }
+            filled.clear();
+            book.add(o, filled);
+            ASSERT_EQ(left, o.quantity);
+            if (left != 0)
+                ref[static_cast<int>(s)][price].push_back(&o);
+        }
+        else if (op < 9 && !orders.empty())
+        {
+            order &o = *orders[rng() % orders.size()];
+            if (book.find(o.id) == &o)
+            {
+                ref_remove(&o);
+                book.cancel(o);
+            }
+        }
+        else
+        {
+            side s = rng() % 2 ? side::buy : side::sell;
+            std::uint64_t qty = 1 + rng() % 30;
+            filled.clear();
+            book.execute(s, qty, filled);
+            for (auto it = filled.begin(); it != filled.end(); ++it)
+                ref_remove(&*it);
+        }
+
+        ASSERT_EQ(!ref[0].empty(), book.has_bid());
+        ASSERT_EQ(!ref[1].empty(), book.has_ask());
+        if (book.has_bid())
+        {
+            ASSERT_EQ(ref[0].rbegin()->first, book.best_bid());
+        }
+        if (book.has_ask())
+        {
+            ASSERT_EQ(ref[1].begin()->first, book.best_ask());
+        }
+    }
+    filled.clear();
+    for (auto &o : orders)
+        book.cancel(*o);
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "intrusive_list.h"
+#include "spin_utils.h"
+
+namespace intrusive
+{
+    struct parking_tag;
+
+    // Global table of waiter queues keyed by address. A lock or condition
+    // only has to keep a couple of bits of its own state: whoever needs to
+    // sleep parks on the address of that state, and the thread record lives
+    // on the sleeper's stack, linked into the queue of the address's bucket.
+    class parking_lot
+    {
+    public:
+        struct unpark_result
+        {
+            bool did_unpark = false;
+            // other threads are still parked on the same address
+            bool may_have_more = false;
+        };
+    private:
+        struct parked_thread : list_element<parking_tag>
+        {
+            void const *address = nullptr;
+            // futex word, becomes 1 once the thread is unparked
+            std::atomic<std::uint32_t> woken{0};
+
+            void sleep() noexcept
+            {
+                while (woken.load(std::memory_order_acquire) == 0)
+                    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&woken),
+                              FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0);
+            }
+
+            // the record may be gone once woken is set, a wake on a dead stack
+            // address is harmless because nothing waits on it any more
+            void wake() noexcept
+            {
+                auto word = reinterpret_cast<std::uint32_t*>(&woken);
+                woken.store(1, std::memory_order_release);
+                ::syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+        };
+
+        struct alignas(detail::cache_line_size) bucket
+        {
+            std::mutex m;
+            list<parked_thread, parking_tag> queue;
+        };
+
+        static constexpr std::size_t bucket_count = 256;
+
+        static bucket &bucket_for(void const *address) noexcept
+        {
+            static bucket table[bucket_count];
+            auto h = reinterpret_cast<std::uintptr_t>(address);
+            h ^= h >> 17;
+            h *= 0x9e3779b97f4a7c15ull;
+            return table[(h >> 32) % bucket_count];
+        }
+    public:
+        parking_lot() = delete;
+
+        // Sleeps on address until unparked. validate() runs under the bucket
+        // lock and may cancel the park by returning false; before_sleep() runs
+        // after the thread is queued, without the lock. Returns whether the
+        // thread was queued and then unparked.
+        template <typename Validate, typename BeforeSleep>
+        static bool park(void const *address, Validate validate, BeforeSleep before_sleep)
+        {
+            parked_thread me;
+            me.address = address;
+            bucket &b = bucket_for(address);
+            {
+                std::lock_guard<std::mutex> lg(b.m);
+                if (!validate())
+                    return false;
+                b.queue.push_back(me);
+            }
+            before_sleep();
+            me.sleep();
+            return true;
+        }
+
+        template <typename Validate>
+        static bool park(void const *address, Validate validate)
+        {
+            return park(address, validate, [] {});
+        }
+
+        // Wakes the oldest thread parked on address. callback(result) runs
+        // under the bucket lock, before the thread wakes, so it can update
+        // the caller's state in step with the queue.
+        template <typename Callback>
+        static unpark_result unpark_one(void const *address, Callback callback)
+        {
+            bucket &b = bucket_for(address);
+            parked_thread *target = nullptr;
+            unpark_result res;
+            {
+                std::lock_guard<std::mutex> lg(b.m);
+                for (auto it = b.queue.begin(); it != b.queue.end(); ++it)
+                {
+                    if (it->address != address)
+                        continue;
+                    if (target == nullptr)
+                    {
+                        target = &*it;
+                        continue;
+                    }
+                    res.may_have_more = true;
+                    break;
+                }
+                if (target != nullptr)
+                {
+                    target->unlink();
+                    res.did_unpark = true;
+                }
+                callback(res);
+            }
+            if (target != nullptr)
+                target->wake();
+            return res;
+        }
+
+        static unpark_result unpark_one(void const *address)
+        {
+            return unpark_one(address, [](unpark_result) {});
+        }
+
+        // wakes every thread parked on address, returns how many
+        static std::size_t unpark_all(void const *address)
+        {
+            bucket &b = bucket_for(address);
+            list<parked_thread, parking_tag> woken;
+            std::size_t count = 0;
+            {
+                std::lock_guard<std::mutex> lg(b.m);
+                for (auto it = b.queue.begin(); it != b.queue.end();)
+                {
+                    auto next = std::next(it);
+                    if (it->address == address)
+                    {
+                        woken.splice(woken.end(), b.queue, it, next);
+                        count++;
+                    }
+                    it = next;
+                }
+            }
+            // pop before waking, the record dies as soon as its thread runs
+            while (!woken.empty())
+            {
+                parked_thread &t = woken.front();
+                woken.pop_front();
+                t.wake();
+            }
+            return count;
+        }
+    };
+
+    // One-byte mutex. Uncontended lock and unlock are a single CAS; a
+    // contended locker spins a little and then parks on the byte.
+    class parking_mutex
+    {
+    private:
+        static constexpr std::uint8_t locked_bit = 1;
+        static constexpr std::uint8_t parked_bit = 2;
+        static constexpr unsigned spin_limit = 40;
+
+        std::atomic<std::uint8_t> word{0};
+
+        void lock_slow() noexcept
+        {
+            unsigned spins = 0;
+            for (;;)
+            {
+                std::uint8_t cur = word.load(std::memory_order_relaxed);
+                if (!(cur & locked_bit))
+                {
+                    if (word.compare_exchange_weak(cur, cur | locked_bit, std::memory_order_acquire,
+                                                   std::memory_order_relaxed))
+                        return;
+                    continue;
+                }
+                // spinning is pointless once others sleep, they would get the lock first
+                if (!(cur & parked_bit) && spins < spin_limit)
+                {
+                    spins++;
+                    detail::cpu_relax();
+                    continue;
+                }
+                if (!(cur & parked_bit)
+                    && !word.compare_exchange_weak(cur, cur | parked_bit, std::memory_order_relaxed))
+                    continue;
+                parking_lot::park(&word, [this] {
+                    return word.load(std::memory_order_relaxed) == (locked_bit | parked_bit);
+                });
+            }
+        }
+
+        void unlock_slow() noexcept
+        {
+            parking_lot::unpark_one(&word, [this](parking_lot::unpark_result r) {
+                // the woken thread competes for the lock like everyone else
+                word.store(r.may_have_more ? parked_bit : 0, std::memory_order_release);
+            });
+        }
+    public:
+        parking_mutex() = default;
+        parking_mutex(parking_mutex const&) = delete;
+        parking_mutex& operator=(parking_mutex const&) = delete;
+
+        void lock() noexcept
+        {
+            std::uint8_t expected = 0;
+            if (!word.compare_exchange_weak(expected, locked_bit, std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+                lock_slow();
+        }
+
+        bool try_lock() noexcept
+        {
+            std::uint8_t cur = word.load(std::memory_order_relaxed);
+            while (!(cur & locked_bit))
+                if (word.compare_exchange_weak(cur, cur | locked_bit, std::memory_order_acquire,
+                                               std::memory_order_relaxed))
+                    return true;
+            return false;
+        }
+
+        void unlock() noexcept
+        {
+            std::uint8_t expected = locked_bit;
+            if (!word.compare_exchange_strong(expected, 0, std::memory_order_release,
+                                              std::memory_order_relaxed))
+                unlock_slow();
+        }
+
+        bool is_locked() const noexcept
+        {
+            return word.load(std::memory_order_relaxed) & locked_bit;
+        }
+    };
+
+    // One-byte condition variable for parking_mutex. Notifications must be
+    // issued after the state they announce was changed under the mutex.
+    class parking_condition
+    {
+    private:
+        std::atomic<bool> has_waiters{false};
+    public:
+        parking_condition() = default;
+        parking_condition(parking_condition const&) = delete;
+        parking_condition& operator=(parking_condition const&) = delete;
+
+        // m must be locked; it is released while sleeping and locked again before returning
+        void wait(parking_mutex &m) noexcept
+        {
+            parking_lot::park(
+                this,
+                [this] {
+                    has_waiters.store(true, std::memory_order_relaxed);
+                    return true;
+                },
+                [&m] { m.unlock(); });
+            m.lock();
+        }
+
+        template <typename Predicate>
+        void wait(parking_mutex &m, Predicate pred)
+        {
+            while (!pred())
+                wait(m);
+        }
+
+        void notify_one() noexcept
+        {
+            if (!has_waiters.load(std::memory_order_relaxed))
+                return;
+            parking_lot::unpark_one(this, [this](parking_lot::unpark_result r) {
+                has_waiters.store(r.may_have_more, std::memory_order_relaxed);
+            });
+        }
+
+        void notify_all() noexcept
+        {
+            if (!has_waiters.load(std::memory_order_relaxed))
+                return;
+            has_waiters.store(false, std::memory_order_relaxed);
+            parking_lot::unpark_all(this);
+        }
+    };
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "parking_lot.h"
+
+static_assert(sizeof(intrusive::parking_mutex) == 1);
+static_assert(sizeof(intrusive::parking_condition) == 1);
+
+namespace
+{
+    // waits until n threads announced themselves and had time to queue
+    void wait_parked(std::atomic<int> &parked, int n)
+    {
+        while (parked.load() != n)
+            std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+}
+
+TEST(parking_lot_testing, validation_cancels_park)
+{
+    int key = 0;
+    bool slept = intrusive::parking_lot::park(&key, [] { return false; });
+    EXPECT_FALSE(slept);
+    auto r = intrusive::parking_lot::unpark_one(&key);
+    EXPECT_FALSE(r.did_unpark);
+    EXPECT_EQ(0u, intrusive::parking_lot::unpark_all(&key));
+}
+
+TEST(parking_lot_testing, unpark_one_in_order)
+{
+    int key = 0;
+    std::atomic<int> parked{0};
+    std::vector<int> order;
+    std::mutex order_mutex;
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 3; ++t)
+    {
+        threads.emplace_back([&, t] {
+            parked++;
+            EXPECT_TRUE(intrusive::parking_lot::park(&key, [] { return true; }));
+            std::lock_guard<std::mutex> lg(order_mutex);
+            order.push_back(t);
+        });
+        wait_parked(parked, t + 1);
+    }
+
+    for (int t = 0; t != 3; ++t)
+    {
+        auto r = intrusive::parking_lot::unpark_one(&key, [&](intrusive::parking_lot::unpark_result res) {
+            EXPECT_TRUE(res.did_unpark);
+            EXPECT_EQ(t != 2, res.may_have_more);
+        });
+        EXPECT_TRUE(r.did_unpark);
+        threads[t].join();
+    }
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+}
+
+TEST(parking_lot_testing, unpark_all_only_matching_address)
+{
+    int a = 0, b = 0;
+    std::atomic<int> parked{0};
+    std::atomic<int> woken_a{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+        threads.emplace_back([&] {
+            parked++;
+            intrusive::parking_lot::park(&a, [] { return true; });
+            woken_a++;
+        });
+    std::thread other([&] {
+        parked++;
+        intrusive::parking_lot::park(&b, [] { return true; });
+    });
+    wait_parked(parked, 5);
+
+    EXPECT_EQ(4u, intrusive::parking_lot::unpark_all(&a));
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(4, woken_a.load());
+
+    EXPECT_EQ(1u, intrusive::parking_lot::unpark_all(&b));
+    other.join();
+}
+
+TEST(parking_lot_testing, mutex_single_thread)
+{
+    intrusive::parking_mutex m;
+    EXPECT_FALSE(m.is_locked());
+    m.lock();
+    EXPECT_TRUE(m.is_locked());
+    EXPECT_FALSE(m.try_lock());
+    m.unlock();
+    EXPECT_TRUE(m.try_lock());
+    m.unlock();
+    EXPECT_FALSE(m.is_locked());
+}
+
+TEST(parking_lot_testing, mutex_contended)
+{
+    constexpr int threads_count = 4;
+    constexpr int iterations = 20000;
+    intrusive::parking_mutex m;
+    long counter = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t != threads_count; ++t)
+        threads.emplace_back([&] {
+            for (int i = 0; i != iterations; ++i)
+            {
+                std::lock_guard<intrusive::parking_mutex> lg(m);
+                counter++;
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(static_cast<long>(threads_count) * iterations, counter);
+    EXPECT_FALSE(m.is_locked());
+}
+
+TEST(parking_lot_testing, condition_producer_consumer)
+{
+    constexpr int items = 10000;
+    intrusive::parking_mutex m;
+    intrusive::parking_condition not_empty;
+    intrusive::parking_condition not_full;
+    std::deque<int> queue;
+    long sum = 0;
+
+    std::vector<std::thread> consumers;
+    for (int c = 0; c != 2; ++c)
+        consumers.emplace_back([&] {
+            for (;;)
+            {
+                std::lock_guard<intrusive::parking_mutex> lg(m);
+                not_empty.wait(m, [&] { return !queue.empty(); });
+                int v = queue.front();
+                queue.pop_front();
+                not_full.notify_one();
+                if (v < 0)
+                    return;
+                sum += v;
+            }
+        });
+
+    for (int i = 1; i <= items + 2; ++i)
+    {
+        std::lock_guard<intrusive::parking_mutex> lg(m);
+        not_full.wait(m, [&] { return queue.size() < 16; });
+        queue.push_back(i <= items ? i : -1);
+        not_empty.notify_one();
+    }
+    for (auto &c : consumers)
+        c.join();
+    EXPECT_EQ(static_cast<long>(items) * (items + 1) / 2, sum);
+}
+
+TEST(parking_lot_testing, condition_notify_all)
+{
+    intrusive::parking_mutex m;
+    intrusive::parking_condition cv;
+    bool go = false;
+    int done = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+        threads.emplace_back([&] {
+            std::lock_guard<intrusive::parking_mutex> lg(m);
+            cv.wait(m, [&] { return go; });
+            done++;
+        });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        std::lock_guard<intrusive::parking_mutex> lg(m);
+        go = true;
+    }
+    cv.notify_all();
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(4, done);
+}
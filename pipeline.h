@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct pipeline_tag;
+
+    // Unit of work owned by the caller; the hook links it into whichever
+    // queue or batch holds it.
+    class pipeline_item : public list_element<pipeline_tag>
+    {
+    public:
+        pipeline_item() = default;
+        pipeline_item(pipeline_item const&) = delete;
+        pipeline_item& operator=(pipeline_item const&) = delete;
+        virtual ~pipeline_item() = default;
+    };
+
+    using pipeline_batch = list<pipeline_item, pipeline_tag>;
+
+    // One step of a pipeline, run on its own thread. process() gets a batch
+    // and may transform, reorder or unlink items; whatever is left in the
+    // batch goes to the next stage. It must not throw.
+    class pipeline_stage
+    {
+    public:
+        pipeline_stage() = default;
+        pipeline_stage(pipeline_stage const&) = delete;
+        pipeline_stage& operator=(pipeline_stage const&) = delete;
+        virtual ~pipeline_stage() = default;
+
+        virtual void process(pipeline_batch &batch) = 0;
+    };
+
+    // Bounded queue moving items in whole batches. A producer blocks while
+    // the queue is at capacity, which propagates backpressure upstream.
+    class pipeline_queue
+    {
+    private:
+        std::mutex m;
+        std::condition_variable not_empty;
+        std::condition_variable not_full;
+        pipeline_batch items;
+        std::size_t size = 0;
+        std::size_t capacity;
+        bool closed = false;
+    public:
+        explicit pipeline_queue(std::size_t capacity)
+            : capacity(capacity == 0 ? 1 : capacity)
+        {}
+        pipeline_queue(pipeline_queue const&) = delete;
+        pipeline_queue& operator=(pipeline_queue const&) = delete;
+
+        // appends all n items of batch, a batch larger than capacity is
+        // accepted once the queue has drained completely
+        void push(pipeline_batch &batch, std::size_t n)
+        {
+            if (n == 0)
+                return;
+            std::unique_lock<std::mutex> lk(m);
+            assert(!closed);
+            not_full.wait(lk, [&] { return size == 0 || size + n <= capacity; });
+            items.splice(items.end(), batch, batch.begin(), batch.end());
+            size += n;
+            lk.unlock();
+            not_empty.notify_one();
+        }
+
+        // moves up to max items into out, waiting for at least one;
+        // returns 0 once the queue is closed and empty
+        std::size_t pop(pipeline_batch &out, std::size_t max)
+        {
+            assert(max != 0);
+            std::unique_lock<std::mutex> lk(m);
+            not_empty.wait(lk, [&] { return size != 0 || closed; });
+            std::size_t n = size < max ? size : max;
+            if (n == size)
+            {
+                out.splice(out.end(), items, items.begin(), items.end());
+            }
+            else
+            {
+                auto last = items.begin();
+                std::advance(last, n);
+                out.splice(out.end(), items, items.begin(), last);
+            }
+            size -= n;
+            lk.unlock();
+            if (n != 0)
+                not_full.notify_all();
+            return n;
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lg(m);
+                closed = true;
+            }
+            not_empty.notify_all();
+        }
+    };
+
+    // Chain of stages connected by bounded queues. Each stage thread takes up
+    // to batch_size items from its input with one splice, processes them and
+    // hands the survivors to the next queue with another. Items fed with
+    // push() come out of pop() in order unless a stage reorders them.
+    class pipeline
+    {
+    private:
+        std::vector<pipeline_stage*> stages;
+        std::size_t batch_size;
+        // queues[i] feeds stages[i], the last one is the output
+        std::vector<std::unique_ptr<pipeline_queue>> queues;
+        std::vector<std::thread> threads;
+        bool closed = false;
+
+        void stage_main(std::size_t i)
+        {
+            pipeline_queue &in = *queues[i];
+            pipeline_queue &out = *queues[i + 1];
+            pipeline_batch batch;
+            while (in.pop(batch, batch_size) != 0)
+            {
+                stages[i]->process(batch);
+                std::size_t n = 0;
+                for (auto it = batch.begin(); it != batch.end(); ++it)
+                    n++;
+                out.push(batch, n);
+            }
+            out.close();
+        }
+    public:
+        // queue_capacity bounds every inter-stage queue and the output, in items
+        pipeline(std::vector<pipeline_stage*> stage_list, std::size_t batch_size = 64,
+                 std::size_t queue_capacity = 1024)
+            : stages(std::move(stage_list))
+            , batch_size(batch_size == 0 ? 1 : batch_size)
+        {
+            for (std::size_t i = 0; i != stages.size() + 1; ++i)
+                queues.emplace_back(new pipeline_queue(queue_capacity));
+            for (std::size_t i = 0; i != stages.size(); ++i)
+                threads.emplace_back([this, i] { stage_main(i); });
+        }
+        pipeline(pipeline const&) = delete;
+        pipeline& operator=(pipeline const&) = delete;
+        // closes the input and waits for the stages, unread output is dropped
+        ~pipeline()
+        {
+            close();
+            pipeline_batch sink;
+            while (queues.back()->pop(sink, batch_size) != 0)
+                sink.clear();
+            for (auto &t : threads)
+                t.join();
+        }
+
+        // blocks while the first queue is full
+        void push(pipeline_item &item)
+        {
+            pipeline_batch one;
+            one.push_back(item);
+            queues.front()->push(one, 1);
+        }
+
+        // feeds n items at once
+        void push(pipeline_batch &batch, std::size_t n)
+        {
+            queues.front()->push(batch, n);
+        }
+
+        // no more input, stages finish what they have and exit in turn
+        void close()
+        {
+            if (closed)
+                return;
+            closed = true;
+            queues.front()->close();
+        }
+
+        // moves up to max finished items into out, waiting for at least one;
+        // returns 0 once the pipeline is closed and fully drained
+        std::size_t pop(pipeline_batch &out, std::size_t max)
+        {
+            return queues.back()->pop(out, max);
+        }
+    };
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "pipeline.h"
+
+namespace
+{
+    struct number : intrusive::pipeline_item
+    {
+        long value = 0;
+    };
+
+    struct add_stage : intrusive::pipeline_stage
+    {
+        explicit add_stage(long delta)
+            : delta(delta)
+        {}
+
+        void process(intrusive::pipeline_batch &batch) override
+        {
+            std::size_t n = 0;
+            for (auto it = batch.begin(); it != batch.end(); ++it, ++n)
+                static_cast<number&>(*it).value += delta;
+            if (n > largest_batch)
+                largest_batch = n;
+        }
+
+        long delta;
+        std::size_t largest_batch = 0;
+    };
+
+    struct drop_odd_stage : intrusive::pipeline_stage
+    {
+        void process(intrusive::pipeline_batch &batch) override
+        {
+            for (auto it = batch.begin(); it != batch.end();)
+                if (static_cast<number&>(*it).value % 2 != 0)
+                    it = batch.erase(it);
+                else
+                    ++it;
+        }
+    };
+
+    std::vector<long> drain(intrusive::pipeline &p)
+    {
+        std::vector<long> res;
+        intrusive::pipeline_batch out;
+        while (p.pop(out, 7) != 0)
+            while (!out.empty())
+            {
+                res.push_back(static_cast<number&>(out.front()).value);
+                out.pop_front();
+            }
+        return res;
+    }
+}
+
+TEST(pipeline_testing, no_stages)
+{
+    std::vector<number> items(10);
+    intrusive::pipeline p({}, 4, 16);
+    for (int i = 0; i != 10; ++i)
+    {
+        items[i].value = i;
+        p.push(items[i]);
+    }
+    p.close();
+    auto res = drain(p);
+    ASSERT_EQ(10u, res.size());
+    for (int i = 0; i != 10; ++i)
+        EXPECT_EQ(i, res[i]);
+}
+
+TEST(pipeline_testing, four_stages_keep_order)
+{
+    constexpr int n = 10000;
+    std::vector<number> items(n);
+    add_stage s1(1), s2(10), s3(100), s4(1000);
+    intrusive::pipeline p({&s1, &s2, &s3, &s4}, 32, 256);
+
+    std::thread producer([&] {
+        for (int i = 0; i != n; ++i)
+        {
+            items[i].value = i;
+            p.push(items[i]);
+        }
+        p.close();
+    });
+    auto res = drain(p);
+    producer.join();
+
+    ASSERT_EQ(static_cast<std::size_t>(n), res.size());
+    for (int i = 0; i != n; ++i)
+        EXPECT_EQ(i + 1111, res[i]);
+    for (auto *s : {&s1, &s2, &s3, &s4})
+        EXPECT_LE(s->largest_batch, 32u);
+}
+
+TEST(pipeline_testing, batch_push_and_filter)
+{
+    constexpr int n = 1000;
+    std::vector<number> items(n);
+    drop_odd_stage filter;
+    add_stage inc(1);
+    intrusive::pipeline p({&filter, &inc}, 16, 64);
+
+    std::thread producer([&] {
+        intrusive::pipeline_batch batch;
+        std::size_t count = 0;
+        for (int i = 0; i != n; ++i)
+        {
+            items[i].value = i;
+            batch.push_back(items[i]);
+            if (++count == 50)
+            {
+                p.push(batch, count);
+                count = 0;
+            }
+        }
+        p.push(batch, count);
+        p.close();
+    });
+    auto res = drain(p);
+    producer.join();
+
+    ASSERT_EQ(static_cast<std::size_t>(n / 2), res.size());
+    for (int i = 0; i != n / 2; ++i)
+        EXPECT_EQ(2 * i + 1, res[i]);
+}
+
+TEST(pipeline_testing, backpressure)
+{
+    constexpr int n = 100;
+    std::vector<number> items(n);
+    add_stage s(0);
+    intrusive::pipeline p({&s}, 1, 2);
+    std::atomic<int> pushed{0};
+
+    std::thread producer([&] {
+        for (int i = 0; i != n; ++i)
+        {
+            items[i].value = i;
+            p.push(items[i]);
+            pushed++;
+        }
+        p.close();
+    });
+    // nobody reads the output: at most the output queue, one batch in the
+    // stage and the input queue can be filled
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_LE(pushed.load(), 5);
+
+    auto res = drain(p);
+    producer.join();
+    EXPECT_EQ(n, pushed.load());
+    EXPECT_EQ(static_cast<std::size_t>(n), res.size());
+}
+
+TEST(pipeline_testing, destroyed_with_unread_output)
+{
+    std::vector<number> items(100);
+    add_stage s(1);
+    {
+        intrusive::pipeline p({&s}, 8, 1000);
+        for (auto &it : items)
+            p.push(it);
+    }
+    for (auto &it : items)
+        EXPECT_FALSE(it.is_linked());
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+
+#include "spin_utils.h"
+
+namespace intrusive
+{
+    // Mellor-Crummey and Scott queue lock. Every waiter brings its own node,
+    // usually on the stack, links it behind the current tail and spins on a
+    // flag inside that node, so each waiter polls only its own cache line and
+    // the lock is handed over in FIFO order.
+    class mcs_lock
+    {
+    public:
+        class alignas(detail::cache_line_size) node
+        {
+        private:
+            friend class mcs_lock;
+            std::atomic<node*> next{nullptr};
+            std::atomic<bool> locked{false};
+        public:
+            node() = default;
+            node(node const&) = delete;
+            node& operator=(node const&) = delete;
+        };
+
+        // holds the lock for its lifetime, the node lives inside the guard
+        class guard
+        {
+        private:
+            mcs_lock &lock;
+            node me;
+        public:
+            explicit guard(mcs_lock &l) noexcept
+                : lock(l)
+            {
+                lock.lock(me);
+            }
+            guard(guard const&) = delete;
+            guard& operator=(guard const&) = delete;
+            ~guard()
+            {
+                lock.unlock(me);
+            }
+        };
+    private:
+        alignas(detail::cache_line_size) std::atomic<node*> tail{nullptr};
+    public:
+        mcs_lock() = default;
+        mcs_lock(mcs_lock const&) = delete;
+        mcs_lock& operator=(mcs_lock const&) = delete;
+        ~mcs_lock()
+        {
+            assert(tail.load(std::memory_order_relaxed) == nullptr);
+        }
+
+        // n must stay alive and untouched until the matching unlock(n)
+        void lock(node &n) noexcept
+        {
+            n.next.store(nullptr, std::memory_order_relaxed);
+            n.locked.store(true, std::memory_order_relaxed);
+            node *prev = tail.exchange(&n, std::memory_order_acq_rel);
+            if (prev == nullptr)
+                return;
+            prev->next.store(&n, std::memory_order_release);
+            detail::spin_wait w;
+            while (n.locked.load(std::memory_order_acquire))
+                w.once();
+        }
+
+        bool try_lock(node &n) noexcept
+        {
+            n.next.store(nullptr, std::memory_order_relaxed);
+            node *expected = nullptr;
+            return tail.compare_exchange_strong(expected, &n, std::memory_order_acquire,
+                                                std::memory_order_relaxed);
+        }
+
+        void unlock(node &n) noexcept
+        {
+            node *succ = n.next.load(std::memory_order_acquire);
+            if (succ == nullptr)
+            {
+                node *expected = &n;
+                if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                                 std::memory_order_relaxed))
+                    return;
+                // a successor swapped the tail but has not linked itself yet
+                detail::spin_wait w;
+                while ((succ = n.next.load(std::memory_order_acquire)) == nullptr)
+                    w.once();
+            }
+            succ->locked.store(false, std::memory_order_release);
+        }
+
+        bool is_locked() const noexcept
+        {
+            return tail.load(std::memory_order_relaxed) != nullptr;
+        }
+    };
+
+    // Craig, Landin and Hagersten queue lock. A waiter swaps its node into the
+    // tail and spins on the node of its predecessor. The released node is
+    // still read by the successor, so nodes cannot live on the stack: each
+    // thread keeps a handle that owns one node, and on unlock the handle takes
+    // over the predecessor's node, which nobody watches any more.
+    // There is no try_lock or is_locked: a node read from the tail may be recycled and
+    // freed by its next owner before the read completes.
+    class clh_lock
+    {
+    private:
+        struct alignas(detail::cache_line_size) node
+        {
+            std::atomic<bool> locked{false};
+        };
+    public:
+        // per-thread state, reusable across locks but used with one at a time
+        class handle
+        {
+        private:
+            friend class clh_lock;
+            node *mine;
+            node *pred = nullptr;
+        public:
+            handle()
+                : mine(new node)
+            {}
+            handle(handle const&) = delete;
+            handle& operator=(handle const&) = delete;
+            ~handle()
+            {
+                assert(pred == nullptr);
+                delete mine;
+            }
+        };
+
+        class guard
+        {
+        private:
+            clh_lock &lock;
+            handle &h;
+        public:
+            guard(clh_lock &l, handle &h) noexcept
+                : lock(l)
+                , h(h)
+            {
+                lock.lock(h);
+            }
+            guard(guard const&) = delete;
+            guard& operator=(guard const&) = delete;
+            ~guard()
+            {
+                lock.unlock(h);
+            }
+        };
+    private:
+        alignas(detail::cache_line_size) std::atomic<node*> tail;
+    public:
+        clh_lock()
+            : tail(new node)
+        {}
+        clh_lock(clh_lock const&) = delete;
+        clh_lock& operator=(clh_lock const&) = delete;
+        ~clh_lock()
+        {
+            node *last = tail.load(std::memory_order_relaxed);
+            assert(!last->locked.load(std::memory_order_relaxed));
+            delete last;
+        }
+
+        void lock(handle &h) noexcept
+        {
+            assert(h.pred == nullptr);
+            h.mine->locked.store(true, std::memory_order_relaxed);
+            h.pred = tail.exchange(h.mine, std::memory_order_acq_rel);
+            detail::spin_wait w;
+            while (h.pred->locked.load(std::memory_order_acquire))
+                w.once();
+        }
+
+        void unlock(handle &h) noexcept
+        {
+            assert(h.pred != nullptr);
+            node *released = h.mine;
+            h.mine = h.pred;
+            h.pred = nullptr;
+            released->locked.store(false, std::memory_order_release);
+        }
+    };
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "queue_lock.h"
+
+namespace
+{
+    constexpr int threads_count = 4;
+    constexpr int iterations = 5000;
+
+    // plain counter with a check that nobody else is inside
+    struct critical
+    {
+        void enter()
+        {
+            EXPECT_FALSE(inside.exchange(true, std::memory_order_relaxed));
+            counter++;
+            inside.store(false, std::memory_order_relaxed);
+        }
+
+        std::atomic<bool> inside{false};
+        long counter = 0;
+    };
+}
+
+TEST(queue_lock_testing, mcs_single_thread)
+{
+    intrusive::mcs_lock l;
+    EXPECT_FALSE(l.is_locked());
+    {
+        intrusive::mcs_lock::guard g(l);
+        EXPECT_TRUE(l.is_locked());
+        intrusive::mcs_lock::node n;
+        EXPECT_FALSE(l.try_lock(n));
+    }
+    EXPECT_FALSE(l.is_locked());
+
+    intrusive::mcs_lock::node n;
+    EXPECT_TRUE(l.try_lock(n));
+    EXPECT_TRUE(l.is_locked());
+    l.unlock(n);
+    EXPECT_FALSE(l.is_locked());
+}
+
+TEST(queue_lock_testing, mcs_mutual_exclusion)
+{
+    intrusive::mcs_lock l;
+    critical c;
+    std::vector<std::thread> threads;
+    for (int t = 0; t != threads_count; ++t)
+        threads.emplace_back([&] {
+            for (int i = 0; i != iterations; ++i)
+            {
+                intrusive::mcs_lock::guard g(l);
+                c.enter();
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(static_cast<long>(threads_count) * iterations, c.counter);
+    EXPECT_FALSE(l.is_locked());
+}
+
+TEST(queue_lock_testing, mcs_try_lock_contended)
+{
+    intrusive::mcs_lock l;
+    critical c;
+    std::atomic<long> failed{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t != threads_count; ++t)
+        threads.emplace_back([&] {
+            for (int i = 0; i != iterations; ++i)
+            {
+                intrusive::mcs_lock::node n;
+                if (l.try_lock(n))
+                {
+                    c.enter();
+                    l.unlock(n);
+                }
+                else
+                {
+                    failed++;
+                }
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(static_cast<long>(threads_count) * iterations, c.counter + failed.load());
+}
+
+TEST(queue_lock_testing, mcs_fifo_handoff)
+{
+    intrusive::mcs_lock l;
+    intrusive::mcs_lock::node first;
+    l.lock(first);
+
+    // waiters are queued one at a time, so they must enter in that order
+    std::vector<int> order;
+    std::vector<std::thread> threads;
+    std::atomic<int> queued{0};
+    for (int t = 0; t != 4; ++t)
+    {
+        threads.emplace_back([&, t] {
+            intrusive::mcs_lock::node n;
+            queued++;
+            l.lock(n);
+            order.push_back(t);
+            l.unlock(n);
+        });
+        // give the thread time to enqueue behind the previous one
+        while (queued.load() != t + 1)
+            std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    l.unlock(first);
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), order);
+}
+
+TEST(queue_lock_testing, clh_mutual_exclusion)
+{
+    intrusive::clh_lock l;
+    critical c;
+    std::vector<std::thread> threads;
+    for (int t = 0; t != threads_count; ++t)
+        threads.emplace_back([&] {
+            intrusive::clh_lock::handle h;
+            for (int i = 0; i != iterations; ++i)
+            {
+                intrusive::clh_lock::guard g(l, h);
+                c.enter();
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+    EXPECT_EQ(static_cast<long>(threads_count) * iterations, c.counter);
+}
+
+TEST(queue_lock_testing, clh_handle_across_locks)
+{
+    intrusive::clh_lock::handle h;
+    {
+        intrusive::clh_lock a, b;
+        for (int i = 0; i != 10; ++i)
+        {
+            {
+                intrusive::clh_lock::guard g(a, h);
+            }
+            intrusive::clh_lock::guard g(b, h);
+        }
+    }
+    intrusive::clh_lock c;
+    c.lock(h);
+    c.unlock(h);
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    class reactor;
+
+    struct reactor_ready_tag;
+    struct reactor_idle_tag;
+    struct reactor_write_tag;
+
+    // Base of everything registered in a reactor.
+    // The hooks link the connection into the ready, idle-timeout and
+    // write-pending lists, so no bookkeeping allocates.
+    class connection
+        : public list_element<reactor_ready_tag>
+        , public list_element<reactor_idle_tag>
+        , public list_element<reactor_write_tag>
+    {
+    private:
+        friend class reactor;
+        int fd_ = -1;
+        std::uint32_t interest = 0;
+        std::uint32_t pending = 0;
+        std::chrono::steady_clock::time_point last_active;
+    public:
+        connection() = default;
+        connection(connection const&) = delete;
+        connection& operator=(connection const&) = delete;
+        virtual ~connection() = default;
+
+        int fd() const noexcept
+        {
+            return fd_;
+        }
+
+        // Called with the ready EPOLL* mask; EPOLLOUT is also delivered to
+        // connections scheduled with reactor::schedule_write. The connection
+        // may be removed and destroyed inside the callback.
+        virtual void on_events(reactor&, std::uint32_t events) = 0;
+        // Called when the connection was not touched for the idle timeout.
+        // The default removes it from the reactor; an override that neither
+        // removes nor touches it keeps it registered for another period.
+        virtual void on_timeout(reactor&);
+    };
+
+    // Level-triggered epoll loop.
+    // Readiness is collected on an intrusive ready list and dispatched in
+    // arrival order; activity moves a connection to the tail of the idle list,
+    // so the list stays ordered by last use and expiry only looks at its head.
+    class reactor
+    {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr int max_events = 256;
+
+        int epfd;
+        clock::duration idle_timeout;
+        clock::time_point now;
+        list<connection, reactor_ready_tag> ready;
+        list<connection, reactor_idle_tag> idle;
+        list<connection, reactor_write_tag> write_pending;
+
+        void ctl(int op, connection &c, std::uint32_t events)
+        {
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.ptr = &c;
+            if (::epoll_ctl(epfd, op, c.fd_, &ev) != 0)
+                throw std::system_error(errno, std::system_category(), "epoll_ctl");
+        }
+
+        void mark_ready(connection &c, std::uint32_t events) noexcept
+        {
+            c.pending |= events;
+            if (!c.list_element<reactor_ready_tag>::is_linked())
+                ready.push_back(c);
+        }
+
+        int wait_timeout(int timeout_ms) const noexcept
+        {
+            if (!ready.empty() || !write_pending.empty())
+                return 0;
+            if (idle_timeout == clock::duration::zero() || idle.empty())
+                return timeout_ms;
+            auto expiry = idle.front().last_active + idle_timeout;
+            auto left = std::chrono::ceil<std::chrono::milliseconds>(expiry - clock::now()).count();
+            if (left < 0)
+                left = 0;
+            if (timeout_ms < 0 || left < timeout_ms)
+                return static_cast<int>(left);
+            return timeout_ms;
+        }
+    public:
+        // idle_timeout of zero disables expiry
+        explicit reactor(clock::duration idle_timeout = clock::duration::zero())
+            : epfd(::epoll_create1(EPOLL_CLOEXEC))
+            , idle_timeout(idle_timeout)
+            , now(clock::now())
+        {
+            if (epfd < 0)
+                throw std::system_error(errno, std::system_category(), "epoll_create1");
+        }
+        reactor(reactor const&) = delete;
+        reactor& operator=(reactor const&) = delete;
+        ~reactor()
+        {
+            ::close(epfd);
+        }
+
+        // registers fd for events (EPOLLIN by default); the fd is not owned
+        void add(connection &c, int fd, std::uint32_t events = EPOLLIN)
+        {
+            c.fd_ = fd;
+            c.interest = events;
+            c.pending = 0;
+            ctl(EPOLL_CTL_ADD, c, events);
+            c.last_active = now;
+            idle.push_back(c);
+        }
+
+        void remove(connection &c) noexcept
+        {
+            if (c.fd_ < 0)
+                return;
+            epoll_event ev{};
+            ::epoll_ctl(epfd, EPOLL_CTL_DEL, c.fd_, &ev);
+            c.list_element<reactor_ready_tag>::unlink();
+            c.list_element<reactor_idle_tag>::unlink();
+            c.list_element<reactor_write_tag>::unlink();
+            c.fd_ = -1;
+        }
+
+        // marks activity, moving c to the tail of the idle list
+        void touch(connection &c) noexcept
+        {
+            c.last_active = now;
+            c.list_element<reactor_idle_tag>::unlink();
+            idle.push_back(c);
+        }
+
+        // delivers EPOLLOUT to c at the end of the current iteration
+        void schedule_write(connection &c) noexcept
+        {
+            if (!c.list_element<reactor_write_tag>::is_linked())
+                write_pending.push_back(c);
+        }
+
+        // arms or disarms EPOLLOUT, for writes that would block
+        void wait_writable(connection &c, bool enable)
+        {
+            std::uint32_t events = enable ? c.interest | EPOLLOUT : c.interest & ~std::uint32_t(EPOLLOUT);
+            if (events == c.interest)
+                return;
+            c.interest = events;
+            ctl(EPOLL_CTL_MOD, c, events);
+        }
+
+        bool empty() const noexcept
+        {
+            return idle.empty();
+        }
+
+        // waits for at most timeout_ms (-1 for no limit), dispatches ready
+        // connections, flushes scheduled writes and expires idle ones.
+        // Returns the number of callbacks invoked.
+        std::size_t run_once(int timeout_ms = -1)
+        {
+            epoll_event events[max_events];
+            int n = ::epoll_wait(epfd, events, max_events, wait_timeout(timeout_ms));
+            if (n < 0 && errno != EINTR)
+                throw std::system_error(errno, std::system_category(), "epoll_wait");
+            now = clock::now();
+            for (int i = 0; i < n; ++i)
+                mark_ready(*static_cast<connection*>(events[i].data.ptr), events[i].events);
+
+            std::size_t res = 0;
+            while (!ready.empty())
+            {
+                connection &c = ready.front();
+                ready.pop_front();
+                std::uint32_t ev = c.pending;
+                c.pending = 0;
+                touch(c);
+                res++;
+                c.on_events(*this, ev);
+            }
+
+            // writes scheduled from here on go to the next iteration
+            list<connection, reactor_write_tag> writes;
+            writes.splice(writes.end(), write_pending, write_pending.begin(), write_pending.end());
+            while (!writes.empty())
+            {
+                connection &c = writes.front();
+                writes.pop_front();
+                res++;
+                c.on_events(*this, EPOLLOUT);
+            }
+
+            if (idle_timeout != clock::duration::zero())
+                while (!idle.empty() && idle.front().last_active + idle_timeout <= now)
+                {
+                    connection &c = idle.front();
+                    res++;
+                    c.on_timeout(*this);
+                    // neither removed nor touched, it gets a new idle period
+                    if (!idle.empty() && &idle.front() == &c)
+                        touch(c);
+                }
+            return res;
+        }
+    };
+
+    inline void connection::on_timeout(reactor &r)
+    {
+        r.remove(*this);
+    }
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "reactor.h"
+#include "test_utils.h"
+
+namespace
+{
+    struct echo_connection : intrusive::connection
+    {
+        std::string out;
+        std::size_t reads = 0;
+        bool closed = false;
+
+        void on_events(intrusive::reactor &r, std::uint32_t events) override
+        {
+            if (events & (EPOLLIN | EPOLLHUP))
+            {
+                char buf[256];
+                ssize_t n = ::read(fd(), buf, sizeof(buf));
+                if (n <= 0)
+                {
+                    closed = true;
+                    r.remove(*this);
+                    return;
+                }
+                reads++;
+                out.append(buf, static_cast<std::size_t>(n));
+                r.schedule_write(*this);
+            }
+            if ((events & EPOLLOUT) && !out.empty())
+            {
+                ssize_t n = ::write(fd(), out.data(), out.size());
+                if (n > 0)
+                    out.erase(0, static_cast<std::size_t>(n));
+                r.wait_writable(*this, !out.empty());
+            }
+        }
+    };
+
+    std::string read_exactly(int fd, std::size_t n)
+    {
+        std::string res(n, '\0');
+        std::size_t got = 0;
+        while (got != n)
+        {
+            ssize_t r = ::read(fd, &res[got], n - got);
+            if (r <= 0)
+                break;
+            got += static_cast<std::size_t>(r);
+        }
+        res.resize(got);
+        return res;
+    }
+}
+
+TEST(reactor_testing, echo)
+{
+    socket_pair sp;
+    echo_connection c;
+    intrusive::reactor r;
+    r.add(c, sp.fds[1]);
+
+    ASSERT_EQ(4, ::write(sp.fds[0], "ping", 4));
+    r.run_once(1000);
+    EXPECT_EQ(1u, c.reads);
+    EXPECT_EQ("ping", read_exactly(sp.fds[0], 4));
+    EXPECT_TRUE(c.out.empty());
+}
+
+TEST(reactor_testing, many_connections)
+{
+    std::vector<socket_pair> pairs(64);
+    std::vector<echo_connection> conns(pairs.size());
+    intrusive::reactor r;
+    for (std::size_t i = 0; i != pairs.size(); ++i)
+        r.add(conns[i], pairs[i].fds[1]);
+
+    for (std::size_t i = 0; i != pairs.size(); i += 2)
+    {
+        std::string msg = std::to_string(i);
+        ASSERT_EQ(static_cast<ssize_t>(msg.size()), ::write(pairs[i].fds[0], msg.data(), msg.size()));
+    }
+    EXPECT_EQ(pairs.size(), r.run_once(1000));
+    for (std::size_t i = 0; i != pairs.size(); i += 2)
+    {
+        std::string msg = std::to_string(i);
+        EXPECT_EQ(msg, read_exactly(pairs[i].fds[0], msg.size()));
+        EXPECT_EQ(1u, conns[i].reads);
+        EXPECT_EQ(0u, conns[i + 1].reads);
+    }
+}
+
+TEST(reactor_testing, hangup_removes)
+{
+    socket_pair sp;
+    echo_connection c;
+    intrusive::reactor r;
+    r.add(c, sp.fds[1]);
+    sp.close(0);
+    r.run_once(1000);
+    EXPECT_TRUE(c.closed);
+    EXPECT_TRUE(r.empty());
+}
+
+TEST(reactor_testing, idle_timeout)
+{
+    socket_pair sp1, sp2;
+    echo_connection c1, c2;
+    intrusive::reactor r(std::chrono::milliseconds(100));
+    r.add(c1, sp1.fds[1]);
+    r.add(c2, sp2.fds[1]);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(1, ::write(sp2.fds[0], "x", 1));
+    r.run_once(0);
+    EXPECT_FALSE(r.empty());
+
+    // c1 expires first, c2 was refreshed by the read
+    while (c1.fd() >= 0)
+        r.run_once(100);
+    EXPECT_GE(c2.fd(), 0);
+    while (!r.empty())
+        r.run_once(100);
+    EXPECT_LT(c2.fd(), 0);
+}
+
+TEST(reactor_testing, reschedule_goes_to_next_iteration)
+{
+    struct flusher : intrusive::connection
+    {
+        int flushes = 0;
+
+        void on_events(intrusive::reactor &r, std::uint32_t events) override
+        {
+            // a partial write asking for another flush
+            if (events & EPOLLOUT)
+            {
+                flushes++;
+                r.schedule_write(*this);
+            }
+        }
+    };
+
+    socket_pair sp;
+    flusher c;
+    intrusive::reactor r;
+    r.add(c, sp.fds[1]);
+    r.schedule_write(c);
+    EXPECT_EQ(1u, r.run_once(0));
+    EXPECT_EQ(1, c.flushes);
+    EXPECT_EQ(1u, r.run_once(0));
+    EXPECT_EQ(2, c.flushes);
+    r.remove(c);
+}
+
+TEST(reactor_testing, timeout_override_keeps_connection)
+{
+    struct stubborn : intrusive::connection
+    {
+        int timeouts = 0;
+
+        void on_events(intrusive::reactor&, std::uint32_t) override
+        {}
+        void on_timeout(intrusive::reactor&) override
+        {
+            timeouts++;
+        }
+    };
+
+    socket_pair sp;
+    stubborn c;
+    intrusive::reactor r(std::chrono::milliseconds(20));
+    r.add(c, sp.fds[1]);
+    while (c.timeouts == 0)
+        r.run_once(100);
+    EXPECT_FALSE(r.empty());
+    // expires again after another full period, not on every iteration
+    EXPECT_EQ(0u, r.run_once(0));
+    while (c.timeouts == 1)
+        r.run_once(100);
+    EXPECT_EQ(2, c.timeouts);
+    r.remove(c);
+    EXPECT_TRUE(r.empty());
+}
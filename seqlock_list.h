@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "intrusive_list.h"
+#include "spin_utils.h"
+
+namespace intrusive
+{
+    namespace detail
+    {
+        // seqlock readers race with writers by design and throw away what
+        // they read when the sequence moved, so ThreadSanitizer is told to
+        // look away while they copy
+#if defined(__SANITIZE_THREAD__)
+        extern "C" void AnnotateIgnoreReadsBegin(const char *file, int line);
+        extern "C" void AnnotateIgnoreReadsEnd(const char *file, int line);
+
+        inline void racy_reads_begin() noexcept
+        {
+            AnnotateIgnoreReadsBegin(__FILE__, __LINE__);
+        }
+        inline void racy_reads_end() noexcept
+        {
+            AnnotateIgnoreReadsEnd(__FILE__, __LINE__);
+        }
+        // tsan does not model fences and warns about them; with the reads
+        // ignored it needs none, keep the compiler from reordering only
+        inline void seqlock_fence(std::memory_order order) noexcept
+        {
+            std::atomic_signal_fence(order);
+        }
+#else
+        inline void racy_reads_begin() noexcept
+        {}
+        inline void racy_reads_end() noexcept
+        {}
+        inline void seqlock_fence(std::memory_order order) noexcept
+        {
+            std::atomic_thread_fence(order);
+        }
+#endif
+    }
+
+    // Small list that monitoring threads can copy without blocking writers.
+    // Writers serialize on a mutex and keep the sequence odd while they
+    // change the list or its nodes; readers walk the list with plain loads,
+    // copy what they need into their own buffer and retry when the sequence
+    // moved under them. Nodes come from a pool owned by the list and are
+    // never freed before it, so a reader racing with an erase still reads
+    // a live T; it may see a null hook or a long detour, both of which end
+    // the attempt. Copy functions should only read plain fields, a pointer
+    // inside a node may be half written when the copy runs.
+    template <typename T, typename Tag = default_tag>
+    class seqlock_list
+    {
+    public:
+        using list_type = list<T, Tag>;
+
+        // exclusive access to the list and its nodes for its lifetime
+        class write_guard
+        {
+        private:
+            seqlock_list &owner;
+            std::lock_guard<std::mutex> lock;
+        public:
+            explicit write_guard(seqlock_list &l)
+                : owner(l)
+                , lock(l.write_mutex)
+            {
+                std::uint64_t s = owner.seq.load(std::memory_order_relaxed);
+                owner.seq.store(s + 1, std::memory_order_relaxed);
+                // the odd sequence must be visible before any change
+                detail::seqlock_fence(std::memory_order_release);
+            }
+            write_guard(write_guard const&) = delete;
+            write_guard& operator=(write_guard const&) = delete;
+            ~write_guard()
+            {
+                std::uint64_t s = owner.seq.load(std::memory_order_relaxed);
+                owner.seq.store(s + 1, std::memory_order_release);
+            }
+
+            list_type &items() noexcept
+            {
+                return owner.items;
+            }
+
+            // a node from the pool, unlinked; a recycled one keeps its old fields
+            T &allocate()
+            {
+                return owner.allocate();
+            }
+
+            // unlinks n if needed and gives it back to the pool
+            void release(T &n)
+            {
+                static_cast<list_element<Tag>&>(n).unlink();
+                owner.free_nodes.push_back(&n);
+            }
+        };
+    private:
+        static constexpr std::size_t first_chunk = 16;
+
+        alignas(detail::cache_line_size) std::atomic<std::uint64_t> seq{0};
+        std::atomic<std::size_t> pool_size{0};
+        std::mutex write_mutex;
+        list_type items;
+        std::vector<std::unique_ptr<T[]>> chunks;
+        std::vector<T*> free_nodes;
+
+        T &allocate()
+        {
+            if (free_nodes.empty())
+            {
+                std::size_t n = chunks.empty() ? first_chunk : pool_size.load(std::memory_order_relaxed);
+                chunks.push_back(std::make_unique<T[]>(n));
+                free_nodes.reserve(free_nodes.size() + n);
+                for (std::size_t i = n; i-- != 0;)
+                    free_nodes.push_back(&chunks.back()[i]);
+                pool_size.store(pool_size.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+            T *n = free_nodes.back();
+            free_nodes.pop_back();
+            return *n;
+        }
+    public:
+        seqlock_list() = default;
+        seqlock_list(seqlock_list const&) = delete;
+        seqlock_list& operator=(seqlock_list const&) = delete;
+        ~seqlock_list()
+        {
+            // nodes die with their chunks, unlink them first
+            items.clear();
+        }
+
+        // Copies the list through copy(T const&, Out&) into out, at most max
+        // elements, and returns the length of the list at the moment of the
+        // copy; a result above max means only the first max were written.
+        // Never blocks a writer, spins while one is active.
+        template <typename Out, typename Copy>
+        std::size_t snapshot(Out *out, std::size_t max, Copy copy) const
+        {
+            detail::spin_wait w;
+            for (;; w.once())
+            {
+                std::uint64_t before = seq.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+                // more steps than nodes means the walk left the list
+                std::size_t limit = pool_size.load(std::memory_order_relaxed);
+                std::size_t n = 0;
+                bool torn = false;
+                detail::racy_reads_begin();
+                for (auto it = items.begin(); it != items.end(); ++it, ++n)
+                {
+                    if (it == typename list_type::const_iterator() || n == limit)
+                    {
+                        torn = true;
+                        break;
+                    }
+                    if (n < max)
+                        copy(*it, out[n]);
+                }
+                detail::racy_reads_end();
+                detail::seqlock_fence(std::memory_order_acquire);
+                if (!torn && seq.load(std::memory_order_relaxed) == before)
+                    return n;
+            }
+        }
+
+        // whole list into out, growing it as needed
+        template <typename Out, typename Copy>
+        void snapshot(std::vector<Out> &out, Copy copy) const
+        {
+            if (out.empty())
+                out.resize(first_chunk);
+            for (;;)
+            {
+                std::size_t n = snapshot(out.data(), out.size(), copy);
+                bool fits = n <= out.size();
+                out.resize(n);
+                if (fits)
+                    return;
+            }
+        }
+
+        // bumped twice by every write, for readers that poll for changes
+        std::uint64_t version() const noexcept
+        {
+            return seq.load(std::memory_order_acquire);
+        }
+    };
+}
@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "seqlock_list.h"
+
+namespace
+{
+    struct job : intrusive::list_element<>
+    {
+        std::uint64_t id = 0;
+        std::uint64_t generation = 0;
+    };
+
+    struct job_info
+    {
+        std::uint64_t id = 0;
+        std::uint64_t generation = 0;
+    };
+
+    using job_list = intrusive::seqlock_list<job>;
+
+    void copy_job(job const& j, job_info &out)
+    {
+        out.id = j.id;
+        out.generation = j.generation;
+    }
+}
+
+TEST(seqlock_list_testing, empty)
+{
+    job_list l;
+    job_info buf[4];
+    EXPECT_EQ(0u, l.snapshot(buf, 4, copy_job));
+    std::vector<job_info> all;
+    l.snapshot(all, copy_job);
+    EXPECT_TRUE(all.empty());
+    EXPECT_EQ(0u, l.version());
+}
+
+TEST(seqlock_list_testing, snapshot_in_order)
+{
+    job_list l;
+    {
+        job_list::write_guard g(l);
+        EXPECT_EQ(1u, l.version());
+        for (std::uint64_t i = 0; i != 5; ++i)
+        {
+            job &j = g.allocate();
+            j.id = i;
+            g.items().push_back(j);
+        }
+    }
+    EXPECT_EQ(2u, l.version());
+    job_info buf[5];
+    ASSERT_EQ(5u, l.snapshot(buf, 5, copy_job));
+    for (std::uint64_t i = 0; i != 5; ++i)
+        EXPECT_EQ(i, buf[i].id);
+}
+
+TEST(seqlock_list_testing, short_buffer)
+{
+    job_list l;
+    {
+        job_list::write_guard g(l);
+        for (std::uint64_t i = 0; i != 40; ++i)
+        {
+            job &j = g.allocate();
+            j.id = i;
+            g.items().push_back(j);
+        }
+    }
+    job_info buf[3];
+    EXPECT_EQ(40u, l.snapshot(buf, 3, copy_job));
+    EXPECT_EQ(2u, buf[2].id);
+
+    std::vector<job_info> all;
+    l.snapshot(all, copy_job);
+    ASSERT_EQ(40u, all.size());
+    EXPECT_EQ(39u, all.back().id);
+}
+
+TEST(seqlock_list_testing, release_recycles)
+{
+    job_list l;
+    job_list::write_guard g(l);
+    job &a = g.allocate();
+    g.items().push_back(a);
+    g.release(a);
+    EXPECT_FALSE(a.is_linked());
+    EXPECT_TRUE(g.items().empty());
+    EXPECT_EQ(&a, &g.allocate());
+}
+
+TEST(seqlock_list_testing, concurrent_snapshots_are_consistent)
+{
+    // the writer keeps generation % 7 + 1 jobs on the list, all stamped with
+    // the generation and numbered from zero; a torn snapshot breaks that
+    job_list l;
+    std::atomic<bool> done{false};
+    constexpr std::uint64_t generations = 20000;
+
+    std::thread writer([&] {
+        for (std::uint64_t gen = 1; gen <= generations; ++gen)
+        {
+            job_list::write_guard g(l);
+            auto &items = g.items();
+            while (!items.empty())
+                g.release(items.front());
+            for (std::uint64_t i = 0; i != gen % 7 + 1; ++i)
+            {
+                job &j = g.allocate();
+                j.id = i;
+                j.generation = gen;
+                items.push_back(j);
+            }
+        }
+        done.store(true);
+    });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r != 2; ++r)
+        readers.emplace_back([&] {
+            job_info buf[8];
+            while (!done.load())
+            {
+                std::size_t n = l.snapshot(buf, 8, copy_job);
+                if (n == 0)
+                    continue;
+                ASSERT_LE(n, 8u);
+                std::uint64_t gen = buf[0].generation;
+                ASSERT_EQ(gen % 7 + 1, n);
+                for (std::size_t i = 0; i != n; ++i)
+                {
+                    ASSERT_EQ(i, buf[i].id);
+                    ASSERT_EQ(gen, buf[i].generation);
+                }
+                std::this_thread::yield();
+            }
+        });
+    writer.join();
+    for (auto &t : readers)
+        t.join();
+
+    job_info buf[8];
+    std::size_t n = l.snapshot(buf, 8, copy_job);
+    EXPECT_EQ(generations % 7 + 1, n);
+    EXPECT_EQ(generations, buf[0].generation);
+    EXPECT_EQ(2 * generations, l.version());
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    // Kernel-style cache of fixed-size objects.
+    // Memory is carved out of slabs; every slab embeds a list_element and
+    // sits in exactly one of the partial, full and empty lists unless a thread
+    // holds it as its current slab through slab_cache::local.
+    template <typename T, std::size_t SlabBytes = 0>
+    class slab_cache
+    {
+    private:
+        struct slab_tag;
+        struct slab;
+
+        union slot
+        {
+            slot *next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+    public:
+        class local;
+
+        struct statistics
+        {
+            std::size_t partial_slabs = 0;
+            std::size_t full_slabs = 0;
+            std::size_t empty_slabs = 0;
+        };
+
+    private:
+        static constexpr std::size_t next_pow2(std::size_t x) noexcept
+        {
+            std::size_t r = 1;
+            while (r < x)
+                r <<= 1;
+            return r;
+        }
+
+        struct slab : list_element<slab_tag>
+        {
+            slot *free = nullptr;
+            // objects freed by other threads while the slab is owned; guarded by the cache mutex
+            slot *remote_free = nullptr;
+            std::size_t remote_count = 0;
+            std::size_t in_use = 0;
+            std::atomic<local*> owner{nullptr};
+
+            slot *slots() noexcept
+            {
+                return reinterpret_cast<slot*>(reinterpret_cast<char*>(this) + header_bytes);
+            }
+        };
+
+        static constexpr std::size_t header_bytes = (sizeof(slab) + alignof(slot) - 1) & ~(alignof(slot) - 1);
+
+    public:
+        // slabs are aligned to their size so an object finds its slab by masking
+        static constexpr std::size_t slab_bytes = SlabBytes != 0
+            ? SlabBytes
+            : next_pow2(header_bytes + 8 * sizeof(slot)) < 4096 ? 4096 : next_pow2(header_bytes + 8 * sizeof(slot));
+        static constexpr std::size_t objects_per_slab = (slab_bytes - header_bytes) / sizeof(slot);
+
+    private:
+        static_assert((slab_bytes & (slab_bytes - 1)) == 0, "slab size must be a power of two");
+        static_assert(objects_per_slab > 0, "slab is too small for the object");
+
+        std::mutex m;
+        list<slab, slab_tag> partial;
+        list<slab, slab_tag> full;
+        list<slab, slab_tag> empty;
+
+        static slab *slab_of(void *p) noexcept
+        {
+            return reinterpret_cast<slab*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(slab_bytes - 1));
+        }
+
+        slab *new_slab()
+        {
+            void *mem = ::operator new(slab_bytes, std::align_val_t(slab_bytes));
+            auto *s = ::new (mem) slab;
+            slot *slots = s->slots();
+            for (std::size_t i = 0; i != objects_per_slab; ++i)
+                slots[i].next = i + 1 == objects_per_slab ? nullptr : &slots[i + 1];
+            s->free = slots;
+            return s;
+        }
+
+        static void delete_slab(slab *s) noexcept
+        {
+            s->~slab();
+            ::operator delete(static_cast<void*>(s), std::align_val_t(slab_bytes));
+        }
+
+        // puts an unowned slab into the list matching its fill level, lock held
+        void place(slab &s) noexcept
+        {
+            s.unlink();
+            if (s.in_use == 0)
+                empty.push_back(s);
+            else if (s.in_use == objects_per_slab)
+                full.push_back(s);
+            else
+                partial.push_front(s);
+        }
+
+        // lock held
+        static void drain_remote(slab &s) noexcept
+        {
+            while (s.remote_free != nullptr)
+            {
+                slot *n = s.remote_free;
+                s.remote_free = n->next;
+                n->next = s.free;
+                s.free = n;
+            }
+            s.in_use -= s.remote_count;
+            s.remote_count = 0;
+        }
+
+        // takes a slab with free space out of the lists, lock held
+        slab &acquire()
+        {
+            slab *s;
+            if (!partial.empty())
+                s = &partial.front();
+            else if (!empty.empty())
+                s = &empty.front();
+            else
+                s = new_slab();
+            s->unlink();
+            return *s;
+        }
+
+        // returns p to a slab not owned by the caller, lock held
+        void deallocate_locked(void *p) noexcept
+        {
+            slab *s = slab_of(p);
+            auto *sl = static_cast<slot*>(p);
+            if (s->owner.load(std::memory_order_relaxed) != nullptr)
+            {
+                sl->next = s->remote_free;
+                s->remote_free = sl;
+                s->remote_count++;
+                return;
+            }
+            sl->next = s->free;
+            s->free = sl;
+            s->in_use--;
+            if (s->in_use == 0 || s->in_use + 1 == objects_per_slab)
+                place(*s);
+        }
+
+    public:
+        slab_cache() = default;
+        slab_cache(slab_cache const&) = delete;
+        slab_cache& operator=(slab_cache const&) = delete;
+
+        // all locals must be destroyed before the cache; outstanding objects are not destructed
+        ~slab_cache()
+        {
+            for (list<slab, slab_tag> *l : {&partial, &full, &empty})
+                while (!l->empty())
+                {
+                    slab *s = &l->front();
+                    l->pop_front();
+                    delete_slab(s);
+                }
+        }
+
+        // returns uninitialized storage for one T
+        void *allocate()
+        {
+            std::lock_guard<std::mutex> lg(m);
+            slab &s = acquire();
+            slot *sl = s.free;
+            s.free = sl->next;
+            s.in_use++;
+            place(s);
+            return sl;
+        }
+
+        void deallocate(void *p) noexcept
+        {
+            if (p == nullptr)
+                return;
+            std::lock_guard<std::mutex> lg(m);
+            deallocate_locked(p);
+        }
+
+        // returns n objects taking the lock once
+        void deallocate_bulk(void *const *p, std::size_t n) noexcept
+        {
+            std::lock_guard<std::mutex> lg(m);
+            for (std::size_t i = 0; i != n; ++i)
+                if (p[i] != nullptr)
+                    deallocate_locked(p[i]);
+        }
+
+        template <typename... Args>
+        T *create(Args&&... args)
+        {
+            void *p = allocate();
+            try
+            {
+                return ::new (p) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                deallocate(p);
+                throw;
+            }
+        }
+
+        void destroy(T *p) noexcept
+        {
+            if (p == nullptr)
+                return;
+            p->~T();
+            deallocate(p);
+        }
+
+        // releases memory of all empty slabs
+        void shrink() noexcept
+        {
+            std::lock_guard<std::mutex> lg(m);
+            while (!empty.empty())
+            {
+                slab *s = &empty.front();
+                empty.pop_front();
+                delete_slab(s);
+            }
+        }
+
+        statistics stats()
+        {
+            statistics res;
+            std::lock_guard<std::mutex> lg(m);
+            for (auto it = partial.begin(); it != partial.end(); ++it)
+                res.partial_slabs++;
+            for (auto it = full.begin(); it != full.end(); ++it)
+                res.full_slabs++;
+            for (auto it = empty.begin(); it != empty.end(); ++it)
+                res.empty_slabs++;
+            return res;
+        }
+
+        // Per-thread front end: allocates from and frees to its current slab
+        // without taking the cache lock. Must be used by a single thread.
+        class local
+        {
+        private:
+            slab_cache *cache;
+            slab *current = nullptr;
+
+            void release_current() noexcept
+            {
+                if (current == nullptr)
+                    return;
+                drain_remote(*current);
+                current->owner.store(nullptr, std::memory_order_relaxed);
+                cache->place(*current);
+                current = nullptr;
+            }
+
+            void refill()
+            {
+                std::lock_guard<std::mutex> lg(cache->m);
+                if (current != nullptr)
+                {
+                    drain_remote(*current);
+                    if (current->free != nullptr)
+                        return;
+                    release_current();
+                }
+                current = &cache->acquire();
+                current->owner.store(this, std::memory_order_relaxed);
+                drain_remote(*current);
+            }
+
+        public:
+            explicit local(slab_cache &cache) noexcept
+                : cache(&cache)
+            {}
+            local(local const&) = delete;
+            local& operator=(local const&) = delete;
+            ~local()
+            {
+                std::lock_guard<std::mutex> lg(cache->m);
+                release_current();
+            }
+
+            void *allocate()
+            {
+                if (current == nullptr || current->free == nullptr)
+                    refill();
+                slot *sl = current->free;
+                current->free = sl->next;
+                current->in_use++;
+                return sl;
+            }
+
+            void deallocate(void *p) noexcept
+            {
+                if (p == nullptr)
+                    return;
+                slab *s = slab_of(p);
+                if (s == current)
+                {
+                    auto *sl = static_cast<slot*>(p);
+                    sl->next = s->free;
+                    s->free = sl;
+                    s->in_use--;
+                    return;
+                }
+                cache->deallocate(p);
+            }
+
+            // frees objects of the current slab locally and the rest under a single lock
+            void deallocate_bulk(void *const *p, std::size_t n) noexcept
+            {
+                std::size_t remote = 0;
+                for (std::size_t i = 0; i != n; ++i)
+                {
+                    if (p[i] == nullptr)
+                        continue;
+                    if (slab_of(p[i]) == current)
+                        deallocate(p[i]);
+                    else
+                        remote++;
+                }
+                if (remote == 0)
+                    return;
+                std::lock_guard<std::mutex> lg(cache->m);
+                for (std::size_t i = 0; i != n; ++i)
+                    if (p[i] != nullptr && slab_of(p[i]) != current)
+                        cache->deallocate_locked(p[i]);
+            }
+
+            template <typename... Args>
+            T *create(Args&&... args)
+            {
+                void *p = allocate();
+                try
+                {
+                    return ::new (p) T(std::forward<Args>(args)...);
+                }
+                catch (...)
+                {
+                    deallocate(p);
+                    throw;
+                }
+            }
+
+            void destroy(T *p) noexcept
+            {
+                if (p == nullptr)
+                    return;
+                p->~T();
+                deallocate(p);
+            }
+        };
+    };
+}
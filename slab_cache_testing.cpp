@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include <vector>
+#include "slab_cache.h"
+
+namespace
+{
+    struct object
+    {
+        explicit object(int value)
+            : value(value)
+        {}
+
+        int value;
+        char payload[60];
+    };
+
+    using cache_t = intrusive::slab_cache<object>;
+}
+
+TEST(slab_cache_testing, create_destroy)
+{
+    cache_t cache;
+    object *a = cache.create(1);
+    object *b = cache.create(2);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(1, a->value);
+    EXPECT_EQ(2, b->value);
+    cache.destroy(a);
+    cache.destroy(b);
+
+    auto st = cache.stats();
+    EXPECT_EQ(0u, st.partial_slabs);
+    EXPECT_EQ(0u, st.full_slabs);
+    EXPECT_EQ(1u, st.empty_slabs);
+}
+
+TEST(slab_cache_testing, slab_states)
+{
+    cache_t cache;
+    std::vector<object*> objects;
+    for (std::size_t i = 0; i != cache_t::objects_per_slab + 1; ++i)
+        objects.push_back(cache.create(static_cast<int>(i)));
+
+    auto st = cache.stats();
+    EXPECT_EQ(1u, st.full_slabs);
+    EXPECT_EQ(1u, st.partial_slabs);
+
+    std::set<object*> unique(objects.begin(), objects.end());
+    EXPECT_EQ(objects.size(), unique.size());
+
+    cache.destroy(objects.back());
+    objects.pop_back();
+    st = cache.stats();
+    EXPECT_EQ(1u, st.full_slabs);
+    EXPECT_EQ(0u, st.partial_slabs);
+    EXPECT_EQ(1u, st.empty_slabs);
+
+    cache.destroy(objects.back());
+    objects.pop_back();
+    st = cache.stats();
+    EXPECT_EQ(0u, st.full_slabs);
+    EXPECT_EQ(1u, st.partial_slabs);
+
+    cache.deallocate_bulk(reinterpret_cast<void* const*>(objects.data()), objects.size());
+    cache.shrink();
+    st = cache.stats();
+    EXPECT_EQ(0u, st.partial_slabs);
+    EXPECT_EQ(0u, st.empty_slabs);
+}
+
+TEST(slab_cache_testing, local)
+{
+    cache_t cache;
+    std::vector<object*> objects;
+    {
+        cache_t::local l(cache);
+        for (int i = 0; i != 1000; ++i)
+            objects.push_back(l.create(i));
+        for (int i = 0; i != 1000; ++i)
+            EXPECT_EQ(i, objects[i]->value);
+        l.deallocate_bulk(reinterpret_cast<void* const*>(objects.data()), objects.size() / 2);
+        objects.erase(objects.begin(), objects.begin() + objects.size() / 2);
+    }
+    for (object *o : objects)
+        cache.deallocate(o);
+    auto st = cache.stats();
+    EXPECT_EQ(0u, st.partial_slabs);
+    EXPECT_EQ(0u, st.full_slabs);
+}
+
+TEST(slab_cache_testing, remote_free)
+{
+    cache_t cache;
+    std::vector<object*> objects;
+    cache_t::local producer(cache);
+    for (int i = 0; i != 10000; ++i)
+        objects.push_back(producer.create(i));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t != 4; ++t)
+        threads.emplace_back([&, t] {
+            cache_t::local l(cache);
+            for (std::size_t i = t; i < objects.size(); i += 4)
+            {
+                EXPECT_EQ(static_cast<int>(i), objects[i]->value);
+                l.destroy(objects[i]);
+                l.destroy(l.create(-1));
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+
+    // remote frees to the producer's current slab are picked up on refill
+    for (int i = 0; i != 10000; ++i)
+        producer.destroy(producer.create(i));
+}
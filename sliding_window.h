@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct window_time_tag;
+    struct window_key_tag;
+
+    template <typename Key, typename Value>
+    class sliding_window;
+
+    // Sample owned by the caller, it must stay alive while in a window.
+    // The time hook keeps it on the window's list in arrival order, the key
+    // hook on the list of its key.
+    template <typename Key, typename Value = double>
+    class window_event
+        : public list_element<window_time_tag>
+        , public list_element<window_key_tag>
+    {
+    private:
+        friend class sliding_window<Key, Value>;
+        std::chrono::steady_clock::time_point at;
+        void *slot = nullptr;
+    public:
+        Key key{};
+        Value value{};
+
+        window_event() = default;
+        window_event(Key key, Value value)
+            : key(std::move(key))
+            , value(std::move(value))
+        {}
+        window_event(window_event const&) = delete;
+        window_event& operator=(window_event const&) = delete;
+
+        std::chrono::steady_clock::time_point time() const noexcept
+        {
+            return at;
+        }
+    };
+
+    // Count and sum over the last `width` of time, in total and per key.
+    // Both are kept up to date as events enter and leave, so queries are
+    // O(1); expiry pops from the front of the time list and subtracts each
+    // event from its key through the pointer stored in the event.
+    // Events must be added in time order.
+    template <typename Key, typename Value = double>
+    class sliding_window
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+        using event = window_event<Key, Value>;
+    private:
+        struct key_state
+        {
+            list<event, window_key_tag> events;
+            std::size_t count = 0;
+            Value sum{};
+        };
+
+        clock::duration width;
+        list<event, window_time_tag> events;
+        std::size_t count_ = 0;
+        Value sum_{};
+        std::unordered_map<Key, key_state> keys;
+
+        void remove(event &e)
+        {
+            auto &ks = *static_cast<typename decltype(keys)::value_type*>(e.slot);
+            e.list_element<window_time_tag>::unlink();
+            e.list_element<window_key_tag>::unlink();
+            e.slot = nullptr;
+            // start over from zero so that rounding errors do not pile up
+            if (--count_ == 0)
+                sum_ = Value{};
+            else
+                sum_ -= e.value;
+            if (--ks.second.count == 0)
+                keys.erase(keys.find(ks.first));
+            else
+                ks.second.sum -= e.value;
+        }
+    public:
+        explicit sliding_window(clock::duration width)
+            : width(width)
+        {}
+        sliding_window(sliding_window const&) = delete;
+        sliding_window& operator=(sliding_window const&) = delete;
+
+        void add(event &e, clock::time_point now = clock::now())
+        {
+            assert(events.empty() || events.back().at <= now);
+            assert(e.slot == nullptr);
+            auto &ks = *keys.try_emplace(e.key).first;
+            e.at = now;
+            e.slot = &ks;
+            events.push_back(e);
+            ks.second.events.push_back(e);
+            ks.second.count++;
+            ks.second.sum += e.value;
+            count_++;
+            sum_ += e.value;
+        }
+
+        // drops events older than now - width, passing each to on_expired,
+        // which may reuse it; returns how many left the window
+        template <typename F>
+        std::size_t advance(clock::time_point now, F on_expired)
+        {
+            std::size_t n = 0;
+            while (!events.empty() && events.front().at + width <= now)
+            {
+                event &e = events.front();
+                remove(e);
+                on_expired(e);
+                n++;
+            }
+            return n;
+        }
+
+        std::size_t advance(clock::time_point now)
+        {
+            return advance(now, [](event&) {});
+        }
+
+        std::size_t count() const noexcept
+        {
+            return count_;
+        }
+        Value sum() const
+        {
+            return sum_;
+        }
+
+        std::size_t count(Key const& k) const
+        {
+            auto it = keys.find(k);
+            return it == keys.end() ? 0 : it->second.count;
+        }
+        Value sum(Key const& k) const
+        {
+            auto it = keys.find(k);
+            return it == keys.end() ? Value{} : it->second.sum;
+        }
+        std::size_t key_count() const noexcept
+        {
+            return keys.size();
+        }
+
+        // visits the live events of k, oldest first
+        template <typename F>
+        void for_each(Key const& k, F f)
+        {
+            auto it = keys.find(k);
+            if (it == keys.end())
+                return;
+            auto &l = it->second.events;
+            for (auto e = l.begin(); e != l.end(); ++e)
+                f(*e);
+        }
+    };
+}
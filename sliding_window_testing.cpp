@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "sliding_window.h"
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using window = intrusive::sliding_window<std::string, long>;
+    using clock_type = window::clock;
+}
+
+TEST(sliding_window_testing, empty)
+{
+    window w(1s);
+    EXPECT_EQ(0u, w.count());
+    EXPECT_EQ(0, w.sum());
+    EXPECT_EQ(0u, w.count("a"));
+    EXPECT_EQ(0u, w.advance(clock_type::now()));
+}
+
+TEST(sliding_window_testing, expiry)
+{
+    auto t = clock_type::now();
+    std::vector<window::event> events(4);
+    window w(10s);
+    const char *keys[] = {"a", "b", "a", "c"};
+    for (int i = 0; i != 4; ++i)
+    {
+        events[i].key = keys[i];
+        events[i].value = i + 1;
+        w.add(events[i], t + std::chrono::seconds(i * 5));
+    }
+    EXPECT_EQ(4u, w.count());
+    EXPECT_EQ(10, w.sum());
+    EXPECT_EQ(2u, w.count("a"));
+    EXPECT_EQ(4, w.sum("a"));
+    EXPECT_EQ(3u, w.key_count());
+
+    // at t + 15s the events from t and t + 5s have left the 10s window
+    std::vector<long> expired;
+    EXPECT_EQ(0u, w.advance(t + 9s));
+    EXPECT_EQ(2u, w.advance(t + 15s, [&](window::event &e) { expired.push_back(e.value); }));
+    EXPECT_EQ((std::vector<long>{1, 2}), expired);
+    EXPECT_EQ(2u, w.count());
+    EXPECT_EQ(7, w.sum());
+    EXPECT_EQ(1u, w.count("a"));
+    EXPECT_EQ(3, w.sum("a"));
+    EXPECT_EQ(0u, w.count("b"));
+    EXPECT_EQ(2u, w.key_count());
+    EXPECT_FALSE(events[0].intrusive::list_element<intrusive::window_time_tag>::is_linked());
+
+    EXPECT_EQ(2u, w.advance(t + 1h));
+    EXPECT_EQ(0u, w.count());
+    EXPECT_EQ(0u, w.key_count());
+}
+
+TEST(sliding_window_testing, for_each_key)
+{
+    auto t = clock_type::now();
+    std::vector<window::event> events(6);
+    window w(1min);
+    for (int i = 0; i != 6; ++i)
+    {
+        events[i].key = i % 2 ? "odd" : "even";
+        events[i].value = i;
+        w.add(events[i], t + std::chrono::seconds(i));
+    }
+    std::vector<long> seen;
+    w.for_each("odd", [&](window::event &e) { seen.push_back(e.value); });
+    EXPECT_EQ((std::vector<long>{1, 3, 5}), seen);
+    seen.clear();
+    w.for_each("none", [&](window::event &e) { seen.push_back(e.value); });
+    EXPECT_TRUE(seen.empty());
+}
+
+TEST(sliding_window_testing, recycle_events)
+{
+    // a fixed pool of events is enough when expired ones are reused
+    auto t = clock_type::now();
+    std::vector<window::event> events(100);
+    std::vector<window::event*> free_events;
+    for (auto &e : events)
+        free_events.push_back(&e);
+    window w(100ms);
+    for (int i = 0; i != 10000; ++i)
+    {
+        auto now = t + std::chrono::milliseconds(i);
+        w.advance(now, [&](window::event &e) { free_events.push_back(&e); });
+        ASSERT_FALSE(free_events.empty());
+        window::event *e = free_events.back();
+        free_events.pop_back();
+        e->key = "k";
+        e->value = 1;
+        w.add(*e, now);
+        EXPECT_EQ(std::min(i + 1, 100), static_cast<int>(w.count()));
+    }
+}
+
+TEST(sliding_window_testing, random)
+{
+    std::mt19937 rng(17);
+    auto t = clock_type::now();
+    constexpr int n = 20000;
+    std::vector<window::event> events(n);
+    window w(500ms);
+    std::deque<int> live;
+    for (int i = 0; i != n; ++i)
+    {
+        t += std::chrono::microseconds(rng() % 200);
+        events[i].key = std::to_string(rng() % 20);
+        events[i].value = static_cast<long>(rng() % 1000);
+        w.add(events[i], t);
+        live.push_back(i);
+        w.advance(t);
+        while (events[live.front()].time() + 500ms <= t)
+            live.pop_front();
+
+        if (i % 97 == 0)
+        {
+            std::map<std::string, std::pair<std::size_t, long>> expected;
+            long total = 0;
+            for (int j : live)
+            {
+                auto &p = expected[events[j].key];
+                p.first++;
+                p.second += events[j].value;
+                total += events[j].value;
+            }
+            ASSERT_EQ(live.size(), w.count());
+            ASSERT_EQ(total, w.sum());
+            ASSERT_EQ(expected.size(), w.key_count());
+            for (auto &kv : expected)
+            {
+                ASSERT_EQ(kv.second.first, w.count(kv.first));
+                ASSERT_EQ(kv.second.second, w.sum(kv.first));
+            }
+        }
+    }
+}
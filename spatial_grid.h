@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    namespace detail
+    {
+        inline void prefetch(void const *p) noexcept
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(p);
+#else
+            (void)p;
+#endif
+        }
+    }
+
+    // Uniform 2D grid whose cells are intrusive lists.
+    // Entities carry a list_element<Tag>; moving one between cells is an
+    // unlink and a push_back, so a simulation tick never allocates.
+    // Positions outside the covered area, infinities included, are clamped
+    // to the border cells; a NaN coordinate counts as 0.
+    template <typename T, typename Tag = default_tag>
+    class spatial_grid
+    {
+    private:
+        float inv_cell_size;
+        std::ptrdiff_t cols;
+        std::ptrdiff_t rows;
+        std::vector<list<T, Tag>> cells;
+
+        // clamped while still a float, converting an out of range value or
+        // a NaN to an integer is undefined; NaN lands in cell 0
+        static std::ptrdiff_t index_of(float v, std::ptrdiff_t count) noexcept
+        {
+            float f = std::floor(v);
+            if (!(f >= 0))
+                return 0;
+            if (f >= static_cast<float>(count - 1))
+                return count - 1;
+            return static_cast<std::ptrdiff_t>(f);
+        }
+        std::ptrdiff_t col_of(float x) const noexcept
+        {
+            return index_of(x * inv_cell_size, cols);
+        }
+        std::ptrdiff_t row_of(float y) const noexcept
+        {
+            return index_of(y * inv_cell_size, rows);
+        }
+        list<T, Tag> &cell_at(float x, float y) noexcept
+        {
+            return cells[static_cast<std::size_t>(row_of(y) * cols + col_of(x))];
+        }
+    public:
+        // covers [0, width) x [0, height)
+        spatial_grid(float width, float height, float cell_size)
+            : inv_cell_size(1 / cell_size)
+            , cols(std::max<std::ptrdiff_t>(1, static_cast<std::ptrdiff_t>(std::ceil(width / cell_size))))
+            , rows(std::max<std::ptrdiff_t>(1, static_cast<std::ptrdiff_t>(std::ceil(height / cell_size))))
+            , cells(static_cast<std::size_t>(cols * rows))
+        {
+            assert(cell_size > 0);
+        }
+        spatial_grid(spatial_grid const&) = delete;
+        spatial_grid& operator=(spatial_grid const&) = delete;
+
+        void insert(T &e, float x, float y) noexcept
+        {
+            cell_at(x, y).push_back(e);
+        }
+
+        // moves e to the cell of its new position
+        void update(T &e, float x, float y) noexcept
+        {
+            static_cast<list_element<Tag>&>(e).unlink();
+            cell_at(x, y).push_back(e);
+        }
+
+        static void erase(T &e) noexcept
+        {
+            static_cast<list_element<Tag>&>(e).unlink();
+        }
+
+        void clear() noexcept
+        {
+            for (auto &c : cells)
+                c.clear();
+        }
+
+        list<T, Tag> const& cell(float x, float y) const noexcept
+        {
+            return cells[static_cast<std::size_t>(row_of(y) * cols + col_of(x))];
+        }
+
+        // Calls f for every entity in the cells overlapping the square around
+        // (x, y) with half side radius; the caller does the exact distance test.
+        template <typename F>
+        void for_each_near(float x, float y, float radius, F &&f)
+        {
+            std::ptrdiff_t c0 = col_of(x - radius), c1 = col_of(x + radius);
+            std::ptrdiff_t r0 = row_of(y - radius), r1 = row_of(y + radius);
+            for (std::ptrdiff_t r = r0; r <= r1; ++r)
+            {
+                list<T, Tag> *row = &cells[static_cast<std::size_t>(r * cols)];
+                for (std::ptrdiff_t c = c0; c <= c1; ++c)
+                {
+                    list<T, Tag> &l = row[c];
+                    if (c != c1 && !row[c + 1].empty())
+                        detail::prefetch(&row[c + 1].front());
+                    auto end = l.end();
+                    for (auto it = l.begin(); it != end;)
+                    {
+                        T &e = *it;
+                        ++it;
+                        if (it != end)
+                            detail::prefetch(&*it);
+                        f(e);
+                    }
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+#include "spatial_grid.h"
+
+namespace
+{
+    struct entity : intrusive::list_element<>
+    {
+        entity(int id, float x, float y)
+            : id(id)
+            , x(x)
+            , y(y)
+        {}
+
+        int id;
+        float x, y;
+    };
+
+    std::set<int> near(intrusive::spatial_grid<entity> &grid, float x, float y, float r)
+    {
+        std::set<int> res;
+        grid.for_each_near(x, y, r, [&](entity &e) {
+            if ((e.x - x) * (e.x - x) + (e.y - y) * (e.y - y) <= r * r)
+                res.insert(e.id);
+        });
+        return res;
+    }
+}
+
+TEST(spatial_grid_testing, insert_update)
+{
+    entity a(1, 5, 5), b(2, 15, 5), c(3, 95, 95);
+    intrusive::spatial_grid<entity> grid(100, 100, 10);
+    grid.insert(a, a.x, a.y);
+    grid.insert(b, b.x, b.y);
+    grid.insert(c, c.x, c.y);
+    EXPECT_EQ(&a, &grid.cell(1, 1).front());
+    EXPECT_EQ((std::set<int>{1, 2}), near(grid, 10, 5, 6));
+
+    a.x = 90;
+    a.y = 90;
+    grid.update(a, a.x, a.y);
+    EXPECT_TRUE(grid.cell(1, 1).empty());
+    EXPECT_EQ((std::set<int>{2}), near(grid, 10, 5, 6));
+    EXPECT_EQ((std::set<int>{1, 3}), near(grid, 92, 92, 5));
+
+    grid.erase(c);
+    EXPECT_EQ((std::set<int>{1}), near(grid, 92, 92, 5));
+}
+
+TEST(spatial_grid_testing, clamp_outside)
+{
+    entity a(1, -5, 200);
+    intrusive::spatial_grid<entity> grid(100, 100, 10);
+    grid.insert(a, a.x, a.y);
+    EXPECT_EQ(&a, &grid.cell(0, 99).front());
+    EXPECT_EQ((std::set<int>{1}), near(grid, -5, 200, 1));
+}
+
+TEST(spatial_grid_testing, clamp_non_finite)
+{
+    float inf = std::numeric_limits<float>::infinity();
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    entity a(1, inf, -inf), b(2, nan, 1e30f);
+    intrusive::spatial_grid<entity> grid(100, 100, 10);
+    grid.insert(a, a.x, a.y);
+    grid.insert(b, b.x, b.y);
+    EXPECT_EQ(&a, &grid.cell(99, 0).front());
+    EXPECT_EQ(&b, &grid.cell(0, 99).front());
+}
+
+TEST(spatial_grid_testing, random_ticks)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(0, 1000), step(-20, 20);
+    std::vector<entity> entities;
+    entities.reserve(2000);
+    for (int i = 0; i != 2000; ++i)
+        entities.emplace_back(i, coord(rng), coord(rng));
+
+    intrusive::spatial_grid<entity> grid(1000, 1000, 25);
+    for (auto &e : entities)
+        grid.insert(e, e.x, e.y);
+
+    for (int tick = 0; tick != 10; ++tick)
+    {
+        for (auto &e : entities)
+        {
+            e.x = std::clamp(e.x + step(rng), 0.f, 999.f);
+            e.y = std::clamp(e.y + step(rng), 0.f, 999.f);
+            grid.update(e, e.x, e.y);
+        }
+
+        float qx = coord(rng), qy = coord(rng), r = 60;
+        std::set<int> expected;
+        for (auto &e : entities)
+            if ((e.x - qx) * (e.x - qx) + (e.y - qy) * (e.y - qy) <= r * r)
+                expected.insert(e.id);
+        EXPECT_EQ(expected, near(grid, qx, qy, r));
+    }
+    grid.clear();
+}
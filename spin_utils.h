@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace intrusive
+{
+    namespace detail
+    {
+        // size used to keep independently written atomics apart
+        constexpr std::size_t cache_line_size = 64;
+
+        // hint to the cpu that the caller is busy waiting
+        inline void cpu_relax() noexcept
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield" ::: "memory");
+#endif
+        }
+
+        // Busy waiting that backs off to the scheduler once spinning has
+        // clearly not paid off, so a waiter does not burn the time slice of
+        // the thread it waits for when there are more threads than cores.
+        class spin_wait
+        {
+        private:
+            static constexpr unsigned spin_limit = 64;
+            unsigned spins = 0;
+        public:
+            void once() noexcept
+            {
+                if (spins < spin_limit)
+                {
+                    spins++;
+                    cpu_relax();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        };
+
+        // One byte test-and-test-and-set lock for hooks that carry a lock of
+        // their own; waiters spin with spin_wait.
+        class byte_spinlock
+        {
+        private:
+            std::atomic<bool> locked{false};
+        public:
+            byte_spinlock() = default;
+            byte_spinlock(byte_spinlock const&) = delete;
+            byte_spinlock& operator=(byte_spinlock const&) = delete;
+
+            void lock() noexcept
+            {
+                spin_wait w;
+                while (locked.load(std::memory_order_relaxed) || locked.exchange(true, std::memory_order_acquire))
+                    w.once();
+            }
+            bool try_lock() noexcept
+            {
+                return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+            }
+            void unlock() noexcept
+            {
+                locked.store(false, std::memory_order_release);
+            }
+        };
+    }
+}
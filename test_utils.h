@@ -1,6 +1,10 @@
 #pragma once
 
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
 
 template <typename C>
 void mass_push_back(C&)
@@ -40,3 +44,72 @@ void expect_eq(C& cont, std::initializer_list<int> values)
                    std::make_reverse_iterator(cont.end()),
                    std::make_reverse_iterator(cont.begin()));
 }
+
+// connected AF_UNIX stream sockets, closed on destruction
+struct socket_pair
+{
+    socket_pair()
+    {
+        EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    }
+    ~socket_pair()
+    {
+        close(0);
+        close(1);
+    }
+    void close(int i)
+    {
+        if (fds[i] >= 0)
+            ::close(fds[i]);
+        fds[i] = -1;
+    }
+
+    int fds[2];
+};
+
+// anonymous temporary file, removed on destruction
+struct temp_file
+{
+    temp_file()
+        : file(std::tmpfile())
+    {}
+    ~temp_file()
+    {
+        std::fclose(file);
+    }
+
+    int fd() const
+    {
+        return fileno(file);
+    }
+
+    std::string contents() const
+    {
+        std::string res;
+        char buf[4096];
+        ::lseek(fd(), 0, SEEK_SET);
+        ssize_t n;
+        while ((n = ::read(fd(), buf, sizeof(buf))) > 0)
+            res.append(buf, static_cast<std::size_t>(n));
+        return res;
+    }
+
+    void reset() const
+    {
+        ASSERT_EQ(0, ::ftruncate(fd(), 0));
+        ::lseek(fd(), 0, SEEK_SET);
+    }
+
+    std::FILE *file;
+};
+
+// Reclaim policy for the epoch_domain containers: sets the element's
+// atomic `reclaimed` flag once it is handed back
+struct mark_reclaimed
+{
+    template <typename T>
+    void operator()(T &e) const noexcept
+    {
+        e.reclaimed.store(true);
+    }
+};
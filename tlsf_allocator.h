@@ -0,0 +1,267 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "bit_utils.h"
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    // Two-level segregated fit allocator over a caller-provided pool.
+    // Free blocks are kept in a matrix of intrusive lists indexed by two bitmaps,
+    // so both allocate and deallocate run in bounded O(1) time.
+    // Physical neighbours are found via boundary tags and coalesced on free.
+    // The pool must outlive the allocator.
+    class tlsf_allocator
+    {
+    private:
+        struct free_tag;
+
+        static constexpr std::size_t align = alignof(std::max_align_t);
+        static constexpr unsigned sl_index_count_log2 = 5;
+        static constexpr unsigned sl_index_count = 1u << sl_index_count_log2;
+        static constexpr unsigned align_log2 = align == 16 ? 4 : align == 8 ? 3 : 2;
+        static constexpr unsigned fl_index_shift = sl_index_count_log2 + align_log2;
+        static constexpr unsigned fl_index_max = sizeof(std::size_t) == 8 ? 32 : 30;
+        static constexpr unsigned fl_index_count = fl_index_max - fl_index_shift + 1;
+        static constexpr std::size_t small_block_size = std::size_t(1) << fl_index_shift;
+
+        static constexpr std::size_t free_bit = 1;
+        static constexpr std::size_t prev_free_bit = 2;
+
+        struct block_header
+        {
+            // boundary tag: physically previous block
+            block_header *prev_phys;
+            // payload size, low bits hold flags
+            std::size_t size_flags;
+
+            std::size_t size() const noexcept
+            {
+                return size_flags & ~(free_bit | prev_free_bit);
+            }
+            void set_size(std::size_t s) noexcept
+            {
+                size_flags = s | (size_flags & (free_bit | prev_free_bit));
+            }
+            bool is_free() const noexcept
+            {
+                return (size_flags & free_bit) != 0;
+            }
+            void set_free(bool f) noexcept
+            {
+                size_flags = f ? size_flags | free_bit : size_flags & ~free_bit;
+            }
+            bool is_prev_free() const noexcept
+            {
+                return (size_flags & prev_free_bit) != 0;
+            }
+            void set_prev_free(bool f) noexcept
+            {
+                size_flags = f ? size_flags | prev_free_bit : size_flags & ~prev_free_bit;
+            }
+            void *payload() noexcept
+            {
+                return reinterpret_cast<char*>(this) + sizeof(block_header);
+            }
+            block_header *next_phys() noexcept
+            {
+                return reinterpret_cast<block_header*>(static_cast<char*>(payload()) + size());
+            }
+        };
+
+        // the hook overlays the payload, so it only exists while the block is free
+        struct free_block : block_header, list_element<free_tag>
+        {};
+
+        static_assert(sizeof(block_header) % align == 0, "block header breaks payload alignment");
+
+        static constexpr std::size_t min_block_size =
+            (sizeof(list_element<free_tag>) + align - 1) & ~(align - 1);
+        static constexpr std::size_t max_block_size = std::size_t(1) << (fl_index_max);
+
+        std::uint32_t fl_bitmap = 0;
+        std::array<std::uint32_t, fl_index_count> sl_bitmap = {};
+        std::array<std::array<list<free_block, free_tag>, sl_index_count>, fl_index_count> blocks;
+
+        static std::size_t align_up(std::size_t x) noexcept
+        {
+            return (x + align - 1) & ~(align - 1);
+        }
+
+        static void mapping_insert(std::size_t size, unsigned &fl, unsigned &sl) noexcept
+        {
+            if (size < small_block_size)
+            {
+                fl = 0;
+                sl = static_cast<unsigned>(size / (small_block_size / sl_index_count));
+            }
+            else
+            {
+                unsigned t = detail::bit_fls(size);
+                sl = static_cast<unsigned>(size >> (t - sl_index_count_log2)) ^ sl_index_count;
+                fl = t - (fl_index_shift - 1);
+            }
+        }
+
+        // rounds up so that any block in the found list is large enough
+        static void mapping_search(std::size_t size, unsigned &fl, unsigned &sl) noexcept
+        {
+            if (size >= small_block_size)
+                size += (std::size_t(1) << (detail::bit_fls(size) - sl_index_count_log2)) - 1;
+            mapping_insert(size, fl, sl);
+        }
+
+        free_block *search_suitable_block(unsigned &fl, unsigned &sl) noexcept
+        {
+            std::uint32_t sl_map = sl_bitmap[fl] & (~std::uint32_t(0) << sl);
+            if (sl_map == 0)
+            {
+                if (fl + 1 >= 32)
+                    return nullptr;
+                std::uint32_t fl_map = fl_bitmap & (~std::uint32_t(0) << (fl + 1));
+                if (fl_map == 0)
+                    return nullptr;
+                fl = detail::bit_ffs(fl_map);
+                sl_map = sl_bitmap[fl];
+            }
+            sl = detail::bit_ffs(sl_map);
+            return &blocks[fl][sl].front();
+        }
+
+        void insert_free(block_header *b) noexcept
+        {
+            unsigned fl, sl;
+            mapping_insert(b->size(), fl, sl);
+            block_header saved = *b;
+            auto *fb = ::new (static_cast<void*>(b)) free_block;
+            fb->prev_phys = saved.prev_phys;
+            fb->size_flags = saved.size_flags;
+            blocks[fl][sl].push_front(*fb);
+            fl_bitmap |= std::uint32_t(1) << fl;
+            sl_bitmap[fl] |= std::uint32_t(1) << sl;
+        }
+
+        void remove_free(block_header *b) noexcept
+        {
+            unsigned fl, sl;
+            mapping_insert(b->size(), fl, sl);
+            static_cast<free_block*>(b)->unlink();
+            if (blocks[fl][sl].empty())
+            {
+                sl_bitmap[fl] &= ~(std::uint32_t(1) << sl);
+                if (sl_bitmap[fl] == 0)
+                    fl_bitmap &= ~(std::uint32_t(1) << fl);
+            }
+        }
+
+        static block_header *header_of(void *p) noexcept
+        {
+            return reinterpret_cast<block_header*>(static_cast<char*>(p) - sizeof(block_header));
+        }
+    public:
+        tlsf_allocator(void *pool, std::size_t bytes) noexcept
+        {
+            auto start = reinterpret_cast<std::uintptr_t>(pool);
+            auto aligned = (start + align - 1) & ~std::uintptr_t(align - 1);
+            if (bytes < aligned - start)
+                return;
+            bytes = (bytes - (aligned - start)) & ~(align - 1);
+            // first block header + sentinel header
+            if (bytes < 2 * sizeof(block_header) + min_block_size)
+                return;
+            std::size_t payload = bytes - 2 * sizeof(block_header);
+            if (payload >= max_block_size)
+                payload = max_block_size - align;
+            assert(payload % align == 0);
+
+            auto *b = reinterpret_cast<block_header*>(aligned);
+            b->prev_phys = nullptr;
+            b->size_flags = payload;
+            b->set_free(true);
+
+            block_header *sentinel = b->next_phys();
+            sentinel->prev_phys = b;
+            sentinel->size_flags = 0;
+            sentinel->set_prev_free(true);
+
+            insert_free(b);
+        }
+
+        tlsf_allocator(tlsf_allocator const&) = delete;
+        tlsf_allocator& operator=(tlsf_allocator const&) = delete;
+
+        // returns nullptr if no sufficiently large block is free
+        void *allocate(std::size_t bytes) noexcept
+        {
+            if (bytes == 0 || bytes > max_block_size / 2)
+                return nullptr;
+            std::size_t size = align_up(bytes);
+            if (size < min_block_size)
+                size = min_block_size;
+
+            unsigned fl, sl;
+            mapping_search(size, fl, sl);
+            if (fl >= fl_index_count)
+                return nullptr;
+            block_header *b = search_suitable_block(fl, sl);
+            if (b == nullptr)
+                return nullptr;
+            remove_free(b);
+
+            if (b->size() >= size + sizeof(block_header) + min_block_size)
+            {
+                auto *rest = reinterpret_cast<block_header*>(static_cast<char*>(b->payload()) + size);
+                rest->prev_phys = b;
+                rest->size_flags = b->size() - size - sizeof(block_header);
+                rest->set_free(true);
+                b->set_size(size);
+                rest->next_phys()->prev_phys = rest;
+                insert_free(rest);
+            }
+            else
+            {
+                b->next_phys()->set_prev_free(false);
+            }
+            b->set_free(false);
+            return b->payload();
+        }
+
+        void deallocate(void *p) noexcept
+        {
+            if (p == nullptr)
+                return;
+            block_header *b = header_of(p);
+            assert(!b->is_free());
+
+            if (b->is_prev_free())
+            {
+                block_header *prev = b->prev_phys;
+                remove_free(prev);
+                prev->set_size(prev->size() + sizeof(block_header) + b->size());
+                b = prev;
+            }
+            block_header *next = b->next_phys();
+            if (next->is_free())
+            {
+                remove_free(next);
+                b->set_size(b->size() + sizeof(block_header) + next->size());
+                next = b->next_phys();
+            }
+            b->set_free(true);
+            next->prev_phys = b;
+            next->set_prev_free(true);
+            insert_free(b);
+        }
+
+        // number of bytes actually usable at p, at least the requested size
+        static std::size_t usable_size(void *p) noexcept
+        {
+            return header_of(p)->size();
+        }
+    };
+}
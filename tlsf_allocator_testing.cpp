@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "tlsf_allocator.h"
+
+namespace
+{
+    struct pool
+    {
+        alignas(std::max_align_t) unsigned char data[1 << 16];
+    };
+}
+
+TEST(tlsf_allocator_testing, allocate_01)
+{
+    pool p;
+    intrusive::tlsf_allocator a(p.data, sizeof(p.data));
+    void *x = a.allocate(10);
+    ASSERT_NE(nullptr, x);
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(x) % alignof(std::max_align_t));
+    EXPECT_GE(intrusive::tlsf_allocator::usable_size(x), 10u);
+    a.deallocate(x);
+}
+
+TEST(tlsf_allocator_testing, allocate_zero)
+{
+    pool p;
+    intrusive::tlsf_allocator a(p.data, sizeof(p.data));
+    EXPECT_EQ(nullptr, a.allocate(0));
+    a.deallocate(nullptr);
+}
+
+TEST(tlsf_allocator_testing, exhaustion)
+{
+    pool p;
+    intrusive::tlsf_allocator a(p.data, sizeof(p.data));
+    EXPECT_EQ(nullptr, a.allocate(sizeof(p.data)));
+
+    std::vector<void*> blocks;
+    while (void *x = a.allocate(1000))
+        blocks.push_back(x);
+    EXPECT_FALSE(blocks.empty());
+    EXPECT_LT(blocks.size(), sizeof(p.data) / 1000 + 1);
+    for (void *x : blocks)
+        a.deallocate(x);
+}
+
+TEST(tlsf_allocator_testing, coalescing)
+{
+    pool p;
+    intrusive::tlsf_allocator a(p.data, sizeof(p.data));
+    void *big = a.allocate(sizeof(p.data) / 2);
+    ASSERT_NE(nullptr, big);
+    a.deallocate(big);
+
+    // fragment the pool, then free in an order that exercises both neighbours
+    std::vector<void*> blocks;
+    for (int i = 0; i != 64; ++i)
+        blocks.push_back(a.allocate(100));
+    for (std::size_t i = 0; i < blocks.size(); i += 2)
+        a.deallocate(blocks[i]);
+    for (std::size_t i = 1; i < blocks.size(); i += 2)
+        a.deallocate(blocks[i]);
+
+    big = a.allocate(sizeof(p.data) / 2);
+    EXPECT_NE(nullptr, big);
+    a.deallocate(big);
+}
+
+TEST(tlsf_allocator_testing, random)
+{
+    pool p;
+    intrusive::tlsf_allocator a(p.data, sizeof(p.data));
+    std::mt19937 rng(42);
+    struct block
+    {
+        unsigned char *data;
+        std::size_t size;
+        unsigned char fill;
+    };
+    std::vector<block> live;
+
+    for (int i = 0; i != 10000; ++i)
+    {
+        if (live.empty() || rng() % 2 == 0)
+        {
+            std::size_t size = 1 + rng() % 2000;
+            auto *x = static_cast<unsigned char*>(a.allocate(size));
+            if (x == nullptr)
+                continue;
+            auto fill = static_cast<unsigned char>(i);
+            std::memset(x, fill, size);
+            live.push_back({x, size, fill});
+        }
+        else
+        {
+            std::swap(live[rng() % live.size()], live.back());
+            block b = live.back();
+            live.pop_back();
+            for (std::size_t j = 0; j != b.size; ++j)
+                ASSERT_EQ(b.fill, b.data[j]);
+            a.deallocate(b.data);
+        }
+    }
+    for (block const& b : live)
+        a.deallocate(b.data);
+    void *all = a.allocate(sizeof(p.data) / 2);
+    EXPECT_NE(nullptr, all);
+}
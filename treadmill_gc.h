@@ -0,0 +1,333 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "intrusive_list.h"
+
+namespace intrusive
+{
+    struct treadmill_tag;
+    struct gc_root_tag;
+
+    class gc_object;
+
+    // Receives the outgoing references of an object during tracing.
+    class gc_visitor
+    {
+    public:
+        virtual void visit(gc_object *p) noexcept = 0;
+    protected:
+        ~gc_visitor() = default;
+    };
+
+    // Base of collected objects. trace() must pass every gc_object pointer
+    // the object holds to the visitor. Destructors run lazily when the cell is
+    // reused and must not touch other collected objects.
+    class gc_object
+    {
+    private:
+        template <std::size_t>
+        friend class treadmill_heap;
+        void *slot = nullptr;
+    public:
+        gc_object() = default;
+        gc_object(gc_object const&) = delete;
+        gc_object& operator=(gc_object const&) = delete;
+        virtual ~gc_object() = default;
+
+        virtual void trace(gc_visitor&) noexcept
+        {}
+    };
+
+    // Strong reference from outside the heap; unregisters itself on destruction.
+    class gc_root : public list_element<gc_root_tag>
+    {
+    private:
+        template <std::size_t>
+        friend class treadmill_heap;
+        gc_visitor *heap = nullptr;
+        gc_object *target = nullptr;
+    public:
+        gc_root() = default;
+        gc_root(gc_root const&) = delete;
+        gc_root& operator=(gc_root const&) = delete;
+        ~gc_root()
+        {
+            unlink();
+        }
+
+        gc_object *get() const noexcept
+        {
+            return target;
+        }
+        void set(gc_object *p) noexcept
+        {
+            target = p;
+            if (heap != nullptr)
+                heap->visit(p);
+        }
+    };
+
+    // Baker's treadmill: a non-moving incremental collector.
+    // All cells sit on one circular intrusive list split into consecutive
+    // segments [white | grey | black | free] by three iterators.
+    // Shading splices a cell from white to the end of grey, scanning and
+    // allocation only move a boundary, and the flip at the end of a cycle
+    // splices the white (garbage) segment behind the free one, so every
+    // colour change is O(1). While a cycle runs, each allocation scans a fixed
+    // number of grey objects, which bounds the pause. Stores of references into
+    // collected objects must go through write_barrier().
+    template <std::size_t CellSize = 64>
+    class treadmill_heap : private gc_visitor
+    {
+    private:
+        struct cell : list_element<treadmill_tag>
+        {
+            // black iff mark == parity, for cells not in grey
+            unsigned char mark = 0;
+            bool grey = false;
+            bool live = false;
+            alignas(std::max_align_t) unsigned char storage[CellSize];
+
+            gc_object *object() noexcept
+            {
+                return std::launder(reinterpret_cast<gc_object*>(storage));
+            }
+        };
+
+        using cell_list = list<cell, treadmill_tag>;
+        using iterator = typename cell_list::iterator;
+
+        std::vector<std::unique_ptr<cell[]>> chunks;
+        cell_list cells;
+        iterator grey_begin;
+        iterator black_begin;
+        iterator free_begin;
+        list<gc_root, gc_root_tag> roots;
+
+        std::size_t chunk_cells;
+        std::size_t work_per_allocation;
+        unsigned char parity = 0;
+        bool collecting = false;
+        std::size_t white_count = 0;
+        std::size_t free_count = 0;
+        std::size_t total = 0;
+        std::size_t cycles_ = 0;
+
+        static cell &cell_of(gc_object *p) noexcept
+        {
+            return *static_cast<cell*>(p->slot);
+        }
+
+        void visit(gc_object *p) noexcept override
+        {
+            if (!collecting || p == nullptr)
+                return;
+            cell &c = cell_of(p);
+            assert(c.live);
+            if (c.grey || c.mark == parity)
+                return;
+            bool grey_empty = grey_begin == black_begin;
+            iterator it = cell_list::iterator_to(c);
+            cells.splice(black_begin, cells, it, std::next(it));
+            c.grey = true;
+            white_count--;
+            if (grey_empty)
+                grey_begin = it;
+        }
+
+        void grow()
+        {
+            chunks.emplace_back(new cell[chunk_cells]);
+            cell *chunk = chunks.back().get();
+            iterator first = cells.end();
+            for (std::size_t i = 0; i != chunk_cells; ++i)
+            {
+                iterator it = cells.insert(cells.end(), chunk[i]);
+                if (i == 0)
+                    first = it;
+            }
+            if (grey_begin == cells.end())
+                grey_begin = first;
+            if (black_begin == cells.end())
+                black_begin = first;
+            if (free_begin == cells.end())
+                free_begin = first;
+            free_count += chunk_cells;
+            total += chunk_cells;
+        }
+
+        void start_cycle() noexcept
+        {
+            assert(!collecting && grey_begin == black_begin && black_begin == free_begin);
+            collecting = true;
+            for (auto it = roots.begin(); it != roots.end(); ++it)
+                visit(it->target);
+        }
+
+        // whites are garbage now, they become free and the blacks become white
+        void flip() noexcept
+        {
+            assert(grey_begin == black_begin);
+            iterator garbage = cells.begin();
+            bool has_garbage = garbage != grey_begin;
+            if (has_garbage)
+            {
+                cells.splice(cells.end(), cells, garbage, grey_begin);
+                if (free_begin == cells.end())
+                    free_begin = garbage;
+            }
+            free_count += white_count;
+            white_count = total - free_count;
+            grey_begin = black_begin = free_begin;
+            parity ^= 1;
+            collecting = false;
+            cycles_++;
+        }
+
+        void scan_one() noexcept
+        {
+            iterator it = std::prev(black_begin);
+            black_begin = it;
+            cell &c = *it;
+            c.grey = false;
+            c.mark = parity;
+            c.object()->trace(*this);
+        }
+
+        void step(std::size_t n) noexcept
+        {
+            for (std::size_t i = 0; i != n && collecting; ++i)
+            {
+                if (grey_begin == black_begin)
+                    flip();
+                else
+                    scan_one();
+            }
+        }
+
+        void finish_cycle() noexcept
+        {
+            while (collecting)
+                step(1);
+        }
+
+        static void destroy(cell &c) noexcept
+        {
+            c.object()->~gc_object();
+            c.live = false;
+        }
+    public:
+        // the heap grows by chunk_cells cells at a time
+        explicit treadmill_heap(std::size_t chunk_cells = 1024, std::size_t work_per_allocation = 4)
+            : grey_begin(cells.end())
+            , black_begin(cells.end())
+            , free_begin(cells.end())
+            , chunk_cells(chunk_cells)
+            , work_per_allocation(work_per_allocation)
+        {}
+        treadmill_heap(treadmill_heap const&) = delete;
+        treadmill_heap& operator=(treadmill_heap const&) = delete;
+        ~treadmill_heap()
+        {
+            while (!roots.empty())
+            {
+                roots.front().heap = nullptr;
+                roots.pop_front();
+            }
+            for (auto it = cells.begin(); it != cells.end(); ++it)
+                if (it->live)
+                    destroy(*it);
+        }
+
+        template <typename T, typename... Args>
+        T *make(Args&&... args)
+        {
+            static_assert(std::is_base_of_v<gc_object, T>, "T must derive from gc_object");
+            static_assert(sizeof(T) <= CellSize, "T does not fit into a cell");
+            static_assert(alignof(T) <= alignof(std::max_align_t), "T is over-aligned");
+
+            if (collecting)
+                step(work_per_allocation);
+            else if (free_count * 4 < total)
+                start_cycle();
+            if (free_begin == cells.end())
+            {
+                if (collecting)
+                    finish_cycle();
+                if (free_begin == cells.end())
+                    grow();
+            }
+
+            cell &c = *free_begin;
+            ++free_begin;
+            // outside a cycle grey and black are empty and the cell becomes white
+            if (!collecting)
+                grey_begin = black_begin = free_begin;
+            free_count--;
+            if (c.live)
+                destroy(c);
+            c.grey = false;
+            if (collecting)
+            {
+                c.mark = parity;
+            }
+            else
+            {
+                c.mark = parity ^ 1;
+                white_count++;
+            }
+            // the cell is fully accounted for as allocated; if the constructor
+            // throws it stays dead and unreachable and the next flip frees it
+            T *obj = ::new (static_cast<void*>(c.storage)) T(std::forward<Args>(args)...);
+            obj->slot = &c;
+            c.live = true;
+            return obj;
+        }
+
+        void add_root(gc_root &r) noexcept
+        {
+            r.unlink();
+            r.heap = this;
+            roots.push_back(r);
+            visit(r.target);
+        }
+
+        // to be called with the new value on every store of a reference into a collected object
+        void write_barrier(gc_object *p) noexcept
+        {
+            visit(p);
+        }
+
+        // runs full cycles until everything unreachable is free
+        void collect() noexcept
+        {
+            finish_cycle();
+            start_cycle();
+            finish_cycle();
+        }
+
+        std::size_t free_cells() const noexcept
+        {
+            return free_count;
+        }
+        std::size_t total_cells() const noexcept
+        {
+            return total;
+        }
+        std::size_t cycles() const noexcept
+        {
+            return cycles_;
+        }
+        bool is_collecting() const noexcept
+        {
+            return collecting;
+        }
+    };
+}
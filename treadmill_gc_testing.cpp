@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "treadmill_gc.h"
+
+namespace
+{
+    int alive = 0;
+
+    struct node : intrusive::gc_object
+    {
+        explicit node(int value)
+            : value(value)
+        {
+            alive++;
+        }
+        ~node() override
+        {
+            alive--;
+        }
+
+        void trace(intrusive::gc_visitor &v) noexcept override
+        {
+            v.visit(left);
+            v.visit(right);
+        }
+
+        int value;
+        node *left = nullptr;
+        node *right = nullptr;
+    };
+
+    struct throwing : intrusive::gc_object
+    {
+        throwing()
+        {
+            throw std::runtime_error("no");
+        }
+    };
+
+    using heap_type = intrusive::treadmill_heap<64>;
+
+    // stores through the barrier like a mutator has to
+    void link(heap_type &heap, node *&field, node *target)
+    {
+        heap.write_barrier(target);
+        field = target;
+    }
+
+    int sum(node *n)
+    {
+        int s = 0;
+        for (; n != nullptr; n = n->right)
+            s += n->value;
+        return s;
+    }
+}
+
+TEST(treadmill_gc_testing, empty)
+{
+    heap_type heap(16);
+    EXPECT_EQ(0u, heap.total_cells());
+    heap.collect();
+    EXPECT_EQ(0u, heap.free_cells());
+}
+
+TEST(treadmill_gc_testing, garbage_is_reclaimed)
+{
+    alive = 0;
+    {
+        heap_type heap(64);
+        intrusive::gc_root root;
+        heap.add_root(root);
+
+        node *head = heap.make<node>(0);
+        root.set(head);
+        node *tail = head;
+        for (int i = 1; i != 10; ++i)
+        {
+            link(heap, tail->right, heap.make<node>(i));
+            tail = tail->right;
+        }
+        for (int i = 0; i != 20; ++i)
+            heap.make<node>(100 + i);
+
+        heap.collect();
+        EXPECT_EQ(heap.total_cells() - 10, heap.free_cells());
+        EXPECT_EQ(45, sum(head));
+
+        root.set(nullptr);
+        heap.collect();
+        EXPECT_EQ(heap.total_cells(), heap.free_cells());
+    }
+    EXPECT_EQ(0, alive);
+}
+
+TEST(treadmill_gc_testing, cells_are_reused)
+{
+    heap_type heap(32);
+    intrusive::gc_root root;
+    heap.add_root(root);
+    node *keep = heap.make<node>(7);
+    root.set(keep);
+    for (int i = 0; i != 10000; ++i)
+        heap.make<node>(i);
+    EXPECT_EQ(32u, heap.total_cells());
+    EXPECT_GT(heap.cycles(), 0u);
+    EXPECT_EQ(7, keep->value);
+}
+
+TEST(treadmill_gc_testing, throwing_constructor)
+{
+    alive = 0;
+    {
+        heap_type heap(8);
+        intrusive::gc_root root;
+        heap.add_root(root);
+        root.set(heap.make<node>(1));
+        for (int i = 0; i != 20; ++i)
+            EXPECT_THROW(heap.make<throwing>(), std::runtime_error);
+        heap.collect();
+        EXPECT_EQ(heap.total_cells() - 1, heap.free_cells());
+        for (int i = 0; i != 7; ++i)
+            heap.make<node>(i);
+        EXPECT_EQ(8u, heap.total_cells());
+        EXPECT_EQ(8, alive);
+    }
+    EXPECT_EQ(0, alive);
+}
+
+TEST(treadmill_gc_testing, grows_when_full)
+{
+    heap_type heap(8);
+    intrusive::gc_root root;
+    heap.add_root(root);
+
+    node *head = heap.make<node>(0);
+    root.set(head);
+    node *tail = head;
+    for (int i = 1; i != 100; ++i)
+    {
+        link(heap, tail->right, heap.make<node>(i));
+        tail = tail->right;
+    }
+    EXPECT_GE(heap.total_cells(), 100u);
+    heap.collect();
+    EXPECT_EQ(4950, sum(head));
+}
+
+TEST(treadmill_gc_testing, cycle_is_incremental)
+{
+    heap_type heap(64, 1);
+    intrusive::gc_root root;
+    heap.add_root(root);
+
+    node *head = heap.make<node>(0);
+    root.set(head);
+    node *tail = head;
+    for (int i = 1; i != 60; ++i)
+    {
+        link(heap, tail->right, heap.make<node>(i));
+        tail = tail->right;
+    }
+    // the cycle has started but one step per allocation cannot finish the chain yet
+    heap.make<node>(-1);
+    EXPECT_TRUE(heap.is_collecting());
+    std::size_t before = heap.cycles();
+    heap.make<node>(-1);
+    EXPECT_EQ(before, heap.cycles());
+
+    heap.collect();
+    EXPECT_FALSE(heap.is_collecting());
+    EXPECT_EQ(1770, sum(head));
+}
+
+TEST(treadmill_gc_testing, write_barrier_during_cycle)
+{
+    heap_type heap(16, 1);
+    intrusive::gc_root root;
+    heap.add_root(root);
+
+    node *a = heap.make<node>(1);
+    root.set(a);
+    node *b = heap.make<node>(2);
+    link(heap, a->left, b);
+    for (int i = 0; i != 12; ++i)
+        heap.make<node>(0);
+    ASSERT_TRUE(heap.is_collecting());
+
+    // move b from the (possibly still grey) a to a fresh black object
+    node *c = heap.make<node>(3);
+    link(heap, a->right, c);
+    link(heap, c->left, b);
+    a->left = nullptr;
+
+    heap.collect();
+    EXPECT_EQ(2, a->right->left->value);
+    EXPECT_EQ(3, a->right->value);
+}
+
+TEST(treadmill_gc_testing, cycles_between_objects)
+{
+    alive = 0;
+    {
+        heap_type heap(16);
+        node *a = heap.make<node>(1);
+        node *b = heap.make<node>(2);
+        link(heap, a->right, b);
+        link(heap, b->right, a);
+        heap.collect();
+        EXPECT_EQ(heap.total_cells(), heap.free_cells());
+    }
+    EXPECT_EQ(0, alive);
+}
+
+TEST(treadmill_gc_testing, random_graph)
+{
+    constexpr int roots_count = 8;
+    std::mt19937 rng(5);
+    heap_type heap(128, 2);
+    std::vector<intrusive::gc_root> roots(roots_count);
+    for (auto &r : roots)
+        heap.add_root(r);
+
+    for (int i = 0; i != 20000; ++i)
+    {
+        node *n = heap.make<node>(i);
+        auto &r = roots[rng() % roots_count];
+        if (rng() % 4 == 0 || r.get() == nullptr)
+        {
+            r.set(n);
+        }
+        else
+        {
+            node *parent = static_cast<node*>(r.get());
+            link(heap, rng() % 2 ? parent->left : parent->right, n);
+        }
+    }
+
+    // every object reachable from the roots must still hold a sane value
+    std::vector<node*> stack;
+    for (auto &r : roots)
+        if (r.get() != nullptr)
+            stack.push_back(static_cast<node*>(r.get()));
+    std::size_t seen = 0;
+    while (!stack.empty())
+    {
+        node *n = stack.back();
+        stack.pop_back();
+        ASSERT_GE(n->value, 0);
+        ASSERT_LT(n->value, 20000);
+        seen++;
+        if (n->left != nullptr)
+            stack.push_back(n->left);
+        if (n->right != nullptr)
+            stack.push_back(n->right);
+    }
+    EXPECT_LE(seen, heap.total_cells());
+    heap.collect();
+    EXPECT_EQ(heap.total_cells() - seen, heap.free_cells());
+}